@@ -0,0 +1,102 @@
+#ifndef BOARDCOMMANDS_H
+#define BOARDCOMMANDS_H
+
+#include <QtEndian>
+
+#include <array>
+#include <string.h>
+
+#include "SlipProtocol.h"
+
+// Measuring board commands described by the packet type, the result kind and the argument
+// types in the packet order. Frame size and dataLen are compile-time constants, the frame
+// lives on the stack and the arguments are stored big endian:
+//
+//   MB_SwitchPower::Frame frame;
+//   MB_SwitchPower::encode(frame, sequence, slot, 1);
+//
+// A new command is one typedef in the table below, plus one line in TestClient::queueBoardCommand()
+// to make it available to the script batches.
+
+// MB_GENERAL_RESULT carries an MB_ERROR_* code ...
+struct MB_Status
+{
+    typedef qint32 Type;
+    static Type decode(qint32 code) {return code;}
+};
+
+// ... or the measured raw value, negative codes are errors as well.
+struct MB_Value
+{
+    typedef qint32 Type;
+    static Type decode(qint32 code) {return code;}
+};
+
+template <typename... Args>
+struct MB_ArgsSize;
+
+template <>
+struct MB_ArgsSize<>
+{
+    static constexpr int value = 0;
+};
+
+template <typename T, typename... Rest>
+struct MB_ArgsSize<T, Rest...>
+{
+    static constexpr int value = sizeof(T) + MB_ArgsSize<Rest...>::value;
+};
+
+inline void MB_putArgs(char *)
+{
+}
+
+template <typename T, typename... Rest>
+inline void MB_putArgs(char *data, T value, Rest... rest)
+{
+    qToBigEndian<T>(value, data);
+    MB_putArgs(data + sizeof(T), rest...);
+}
+
+template <quint16 Type, typename Result, typename... Args>
+struct MB_Command
+{
+    static constexpr quint16 type = Type;
+    static constexpr int dataLen = MB_ArgsSize<Args...>::value;
+    static constexpr int size = sizeof(MB_Packet_t) + dataLen;
+
+    typedef std::array<char, size> Frame;
+    typedef typename Result::Type ResultType;
+
+    static void encode(Frame &frame, quint8 sequence, Args... args)
+    {
+        MB_Packet_t header;
+
+        header.type = qToBigEndian<quint16>(Type);
+        header.sequence = sequence;
+        header.dataLen = dataLen;
+        memcpy(frame.data(), &header, sizeof(header));
+        MB_putArgs(frame.data() + sizeof(header), args...);
+    }
+
+    static ResultType decode(qint32 code) {return Result::decode(code);}
+};
+
+// Command table. Arguments:
+typedef MB_Command<MB_SWITCH_SWD, MB_Status, quint8> MB_SwitchSwd;                                  // DUT
+typedef MB_Command<MB_SWITCH_POWER, MB_Status, quint8, quint8> MB_SwitchPower;                      // DUT, state
+typedef MB_Command<MB_READ_DIN, MB_Value, quint8, quint8> MB_ReadDin;                               // DUT, DIN
+typedef MB_Command<MB_WRITE_DOUT, MB_Status, quint8, quint8, quint8> MB_WriteDout;                  // DUT, DOUT, state
+typedef MB_Command<MB_READ_CSA, MB_Value, quint8> MB_ReadCsa;                                       // Gain
+typedef MB_Command<MB_READ_ANALOG, MB_Value, quint8, quint8, quint8> MB_ReadAnalog;                 // DUT, AIN, gain
+typedef MB_Command<MB_CONFIG_DUT_DEBUG, MB_Status, quint8, quint32, quint8, quint8, quint8> MB_ConfigDutDebug;  // DUT, baud rate, bits, parity, stop bits
+typedef MB_Command<MB_SWITCH_DALI, MB_Status, quint8> MB_SwitchDali;                                // State
+typedef MB_Command<MB_READ_DALI_ADC, MB_Value> MB_ReadDaliAdc;
+typedef MB_Command<MB_READ_DIN_ADC, MB_Value, quint8, quint8> MB_ReadDinAdc;                        // DUT, DIN
+typedef MB_Command<MB_READ_ADC_24V, MB_Value> MB_Read24V;
+typedef MB_Command<MB_READ_ADC_3V, MB_Value> MB_Read3V;
+typedef MB_Command<MB_READ_ADC_TEMP, MB_Value> MB_ReadTemperature;
+
+static_assert(MB_ConfigDutDebug::size == sizeof(MB_ConfigDutDebug_t), "MB_ConfigDutDebug layout");
+
+#endif // BOARDCOMMANDS_H
@@ -0,0 +1,348 @@
+#include "Crc16.h"
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#   define CRC16_X86_CLMUL
+#   include <immintrin.h>
+#   if defined(_MSC_VER)
+#       include <intrin.h>
+#   else
+#       include <cpuid.h>
+#   endif
+#elif defined(__aarch64__) && defined(__ARM_FEATURE_CRYPTO)
+#   define CRC16_ARM_PMULL
+#   include <arm_neon.h>
+#   if defined(__linux__)
+#       include <sys/auxv.h>
+#       include <asm/hwcap.h>
+#   endif
+#endif
+
+#if defined(CRC16_X86_CLMUL) && defined(__GNUC__)
+#   define CRC16_TARGET_CLMUL __attribute__((target("pclmul,ssse3")))
+#else
+#   define CRC16_TARGET_CLMUL
+#endif
+
+const quint16 Crc16::lut[256] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108,
+    0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef, 0x1231, 0x0210,
+    0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b,
+    0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401,
+    0x64e6, 0x74c7, 0x44a4, 0x5485, 0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee,
+    0xf5cf, 0xc5ac, 0xd58d, 0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6,
+    0x5695, 0x46b4, 0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d,
+    0xc7bc, 0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
+    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b, 0x5af5,
+    0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12, 0xdbfd, 0xcbdc,
+    0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a, 0x6ca6, 0x7c87, 0x4ce4,
+    0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41, 0xedae, 0xfd8f, 0xcdec, 0xddcd,
+    0xad2a, 0xbd0b, 0x8d68, 0x9d49, 0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13,
+    0x2e32, 0x1e51, 0x0e70, 0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a,
+    0x9f59, 0x8f78, 0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e,
+    0xe16f, 0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
+    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e, 0x02b1,
+    0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256, 0xb5ea, 0xa5cb,
+    0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d, 0x34e2, 0x24c3, 0x14a0,
+    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xa7db, 0xb7fa, 0x8799, 0x97b8,
+    0xe75f, 0xf77e, 0xc71d, 0xd73c, 0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657,
+    0x7676, 0x4615, 0x5634, 0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9,
+    0xb98a, 0xa9ab, 0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882,
+    0x28a3, 0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
+    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92, 0xfd2e,
+    0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9, 0x7c26, 0x6c07,
+    0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d,
+    0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
+    0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
+};
+
+struct Slicing8Tables
+{
+    quint16 t[8][256];
+
+    Slicing8Tables()
+    {
+        // t[k][b] - contribution of the byte b followed by k zero bytes.
+        for (int b = 0; b < 256; ++b)
+        {
+            t[0][b] = Crc16::lut[b];
+            for (int k = 1; k < 8; ++k)
+                t[k][b] = Crc16::lut[t[k - 1][b] >> 8] ^ (quint16)(t[k - 1][b] << 8);
+        }
+    }
+};
+
+static const Slicing8Tables &_slicing8Tables()
+{
+    static const Slicing8Tables tables;
+
+    return tables;
+}
+
+// x^n mod P, used for the folding constants.
+static quint32 _xPowMod(int n)
+{
+    quint32 r = 1;
+
+    for (int i = 0; i < n; ++i)
+    {
+        r <<= 1;
+        if (r & 0x10000)
+            r ^= 0x11021;
+    }
+
+    return r;
+}
+
+// Folding keeps a 128 bit value congruent to the processed message modulo P:
+// X * x^n = X_hi * (x^(n + 64) mod P) + X_lo * (x^n mod P), every product fits 79 bits.
+// The remainder is reduced by the table, because CRC of a block with zero
+// initial value is (block * x^16) mod P. The initial value is XORed into the
+// first 16 message bits, which gives the same result as the register preset.
+
+#if defined(CRC16_X86_CLMUL)
+
+static bool _cpuHasClmul()
+{
+#if defined(_MSC_VER)
+    int info[4];
+
+    __cpuid(info, 1);
+
+    return (info[2] & (1 << 1)) && (info[2] & (1 << 9));
+#else
+    unsigned int eax, ebx, ecx, edx;
+
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    return (ecx & bit_PCLMUL) && (ecx & bit_SSSE3);
+#endif
+}
+
+CRC16_TARGET_CLMUL
+static inline __m128i _load(const quint8 *data, __m128i reverse)
+{
+    // Big endian polynomial: the first message byte holds the highest coefficients.
+    return _mm_shuffle_epi8(_mm_loadu_si128((const __m128i*)data), reverse);
+}
+
+CRC16_TARGET_CLMUL
+static inline __m128i _fold(__m128i x, __m128i k, __m128i block)
+{
+    return _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128(x, k, 0x11), _mm_clmulepi64_si128(x, k, 0x00)), block);
+}
+
+CRC16_TARGET_CLMUL
+static quint16 _ccittFolding(const quint8 *data, qint64 size, quint16 crc)
+{
+    static const int
+        k128 = _xPowMod(128),
+        k192 = _xPowMod(192),
+        k512 = _xPowMod(512),
+        k576 = _xPowMod(576);
+
+    if (size < 64)
+        return Crc16::ccittSlicing8(data, size, crc);
+
+    const __m128i
+        reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        fold128 = _mm_set_epi32(0, k192, 0, k128),
+        fold512 = _mm_set_epi32(0, k576, 0, k512);
+
+    // Four independent lanes hide the multiplication latency.
+    __m128i
+        x0 = _mm_xor_si128(_load(data, reverse), _mm_set_epi32((int)((quint32)crc << 16), 0, 0, 0)),
+        x1 = _load(data + 16, reverse),
+        x2 = _load(data + 32, reverse),
+        x3 = _load(data + 48, reverse);
+
+    data += 64;
+    size -= 64;
+    for (; size >= 64; data += 64, size -= 64)
+    {
+        x0 = _fold(x0, fold512, _load(data, reverse));
+        x1 = _fold(x1, fold512, _load(data + 16, reverse));
+        x2 = _fold(x2, fold512, _load(data + 32, reverse));
+        x3 = _fold(x3, fold512, _load(data + 48, reverse));
+    }
+
+    __m128i x = _fold(_fold(_fold(x0, fold128, x1), fold128, x2), fold128, x3);
+
+    for (; size >= 16; data += 16, size -= 16)
+        x = _fold(x, fold128, _load(data, reverse));
+
+    quint8 block[16];
+
+    _mm_storeu_si128((__m128i*)block, _mm_shuffle_epi8(x, reverse));
+
+    return Crc16::ccittSlicing8(data, size, Crc16::ccittSlicing8(block, sizeof(block), 0));
+}
+
+#elif defined(CRC16_ARM_PMULL)
+
+static bool _cpuHasClmul()
+{
+#if defined(__linux__)
+    return getauxval(AT_HWCAP) & HWCAP_PMULL;
+#else
+    return true;
+#endif
+}
+
+static inline uint8x16_t _load(const quint8 *data)
+{
+    // Big endian polynomial: the first message byte holds the highest coefficients.
+    uint8x16_t v = vrev64q_u8(vld1q_u8(data));
+
+    return vextq_u8(v, v, 8);
+}
+
+static inline uint8x16_t _fold(uint8x16_t x, poly64_t kHi, poly64_t kLo, uint8x16_t block)
+{
+    poly64x2_t v = vreinterpretq_p64_u8(x);
+    uint8x16_t
+        hi = vreinterpretq_u8_p128(vmull_p64(vgetq_lane_p64(v, 1), kHi)),
+        lo = vreinterpretq_u8_p128(vmull_p64(vgetq_lane_p64(v, 0), kLo));
+
+    return veorq_u8(veorq_u8(hi, lo), block);
+}
+
+static quint16 _ccittFolding(const quint8 *data, qint64 size, quint16 crc)
+{
+    static const poly64_t
+        k128 = _xPowMod(128),
+        k192 = _xPowMod(192),
+        k512 = _xPowMod(512),
+        k576 = _xPowMod(576);
+
+    if (size < 64)
+        return Crc16::ccittSlicing8(data, size, crc);
+
+    uint8x16_t init = vdupq_n_u8(0);
+
+    init = vsetq_lane_u8(crc >> 8, init, 15);
+    init = vsetq_lane_u8(crc & 0xFF, init, 14);
+
+    // Four independent lanes hide the multiplication latency.
+    uint8x16_t
+        x0 = veorq_u8(_load(data), init),
+        x1 = _load(data + 16),
+        x2 = _load(data + 32),
+        x3 = _load(data + 48);
+
+    data += 64;
+    size -= 64;
+    for (; size >= 64; data += 64, size -= 64)
+    {
+        x0 = _fold(x0, k576, k512, _load(data));
+        x1 = _fold(x1, k576, k512, _load(data + 16));
+        x2 = _fold(x2, k576, k512, _load(data + 32));
+        x3 = _fold(x3, k576, k512, _load(data + 48));
+    }
+
+    uint8x16_t x = _fold(_fold(_fold(x0, k192, k128, x1), k192, k128, x2), k192, k128, x3);
+
+    for (; size >= 16; data += 16, size -= 16)
+        x = _fold(x, k192, k128, _load(data));
+
+    quint8 block[16];
+    uint8x16_t r = vrev64q_u8(x);
+
+    vst1q_u8(block, vextq_u8(r, r, 8));
+
+    return Crc16::ccittSlicing8(data, size, Crc16::ccittSlicing8(block, sizeof(block), 0));
+}
+
+#endif
+
+typedef quint16 (*CrcFunction)(const quint8 *data, qint64 size, quint16 crc);
+
+struct CrcImplementation
+{
+    CrcFunction function;
+    const char *name;
+};
+
+static quint16 _ccittSlicing8(const quint8 *data, qint64 size, quint16 crc)
+{
+    return Crc16::ccittSlicing8(data, size, crc);
+}
+
+static CrcImplementation _selectImplementation()
+{
+#if defined(CRC16_X86_CLMUL)
+    if (_cpuHasClmul())
+        return {_ccittFolding, "pclmulqdq"};
+#elif defined(CRC16_ARM_PMULL)
+    if (_cpuHasClmul())
+        return {_ccittFolding, "pmull"};
+#endif
+
+    return {_ccittSlicing8, "slicing-by-8"};
+}
+
+static const CrcImplementation &_implementation()
+{
+    static const CrcImplementation implementation = _selectImplementation();
+
+    return implementation;
+}
+
+quint16 Crc16::ccitt(const void *data, qint64 size, quint16 crc)
+{
+    return _implementation().function((const quint8*)data, size, crc);
+}
+
+quint16 Crc16::ccittBytewise(const void *data, qint64 size, quint16 crc)
+{
+    const quint8 *p = (const quint8*)data;
+
+    while (size-- > 0)
+        crc = update(crc, *p++);
+
+    return crc;
+}
+
+quint16 Crc16::ccittSlicing8(const void *data, qint64 size, quint16 crc)
+{
+    const Slicing8Tables &tables = _slicing8Tables();
+    const quint8 *p = (const quint8*)data;
+
+    for (; size >= 8; p += 8, size -= 8)
+    {
+        quint32 x = crc ^ ((p[0] << 8) | p[1]);
+
+        crc = tables.t[7][x >> 8] ^ tables.t[6][x & 0xFF]
+            ^ tables.t[5][p[2]] ^ tables.t[4][p[3]]
+            ^ tables.t[3][p[4]] ^ tables.t[2][p[5]]
+            ^ tables.t[1][p[6]] ^ tables.t[0][p[7]];
+    }
+
+    return ccittBytewise(p, size, crc);
+}
+
+quint16 Crc16::ccittFolding(const void *data, qint64 size, quint16 crc)
+{
+#if defined(CRC16_X86_CLMUL) || defined(CRC16_ARM_PMULL)
+    if (hasFolding())
+        return _ccittFolding((const quint8*)data, size, crc);
+#endif
+
+    return ccittSlicing8(data, size, crc);
+}
+
+bool Crc16::hasFolding()
+{
+#if defined(CRC16_X86_CLMUL) || defined(CRC16_ARM_PMULL)
+    static const bool supported = _cpuHasClmul();
+
+    return supported;
+#else
+    return false;
+#endif
+}
+
+const char *Crc16::implementation()
+{
+    return _implementation().name;
+}
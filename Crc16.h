@@ -0,0 +1,37 @@
+#ifndef CRC16_H
+#define CRC16_H
+
+#include <QtGlobal>
+
+// CRC-16/CCITT-FALSE: polynomial 0x1021, initial value 0xFFFF, no reflection, no final XOR.
+// Used by the SLIP link and suitable for firmware image checksums.
+//
+// Block calculation is dispatched at run time: carry-less multiply folding
+// (PCLMULQDQ on x86, PMULL on ARM) when the CPU supports it, slicing-by-8 otherwise.
+class Crc16
+{
+public:
+
+    static quint16 ccitt(const void *data, qint64 size, quint16 crc = 0xFFFF);
+
+    // Byte at a time update for the streaming decoders.
+    static inline quint16 update(quint16 crc, quint8 byte) Q_DECL_NOTHROW
+    {
+        return lut[byte ^ (crc >> 8)] ^ (crc << 8);
+    }
+
+    // Reference implementations, exposed for verification.
+    static quint16 ccittBytewise(const void *data, qint64 size, quint16 crc = 0xFFFF);
+    static quint16 ccittSlicing8(const void *data, qint64 size, quint16 crc = 0xFFFF);
+
+    // Carry-less multiply folding, only when hasFolding() is true.
+    static quint16 ccittFolding(const void *data, qint64 size, quint16 crc = 0xFFFF);
+    static bool hasFolding();
+
+    // Name of the implementation selected for this CPU.
+    static const char *implementation();
+
+    static const quint16 lut[256];
+};
+
+#endif // CRC16_H
@@ -0,0 +1,179 @@
+#include "Dut.h"
+
+#include <QHash>
+#include <QMutex>
+#include <QSet>
+#include <QStringList>
+
+static const char *const _fieldNames[Dut::FIELD_COUNT] = {
+    "state",
+    "id",
+    "no",
+    "error",
+    "checked",
+    "railtestDownloaded",
+    "voltageChecked",
+    "accelChecked",
+    "lightSensChecked",
+    "daliChecked",
+    "radioChecked",
+    "gnssChecked",
+    "rtcChecked",
+    "dinChecked",
+    "current",
+    "voltage",
+    "rssi",
+    "packets"
+};
+
+// Error texts repeat across the DUTs of a session, so DUTs share the text data of the
+// first copy. Texts with measured values never repeat, the table stops growing at
+// MAX_ERROR_TEXTS and later texts are kept by the DUT alone. Shared by the test client threads.
+static constexpr int MAX_ERROR_TEXTS = 1024;
+static QMutex _errorMutex;
+static QSet<QString> _errorTexts;
+
+static QString _internError(const QString &text)
+{
+    QMutexLocker locker(&_errorMutex);
+    auto it = _errorTexts.constFind(text);
+
+    if (it != _errorTexts.constEnd())
+        return *it;
+
+    if (_errorTexts.size() < MAX_ERROR_TEXTS)
+        _errorTexts.insert(text);
+
+    return text;
+}
+
+Dut::Field Dut::field(const QString &name)
+{
+    static const QHash<QString, int> fields = []
+    {
+        QHash<QString, int> result;
+
+        for (int i = 0; i < FIELD_COUNT; ++i)
+            result.insert(QString::fromLatin1(_fieldNames[i]), i);
+
+        return result;
+    }();
+
+    return (Field)fields.value(name, Extra);
+}
+
+QString Dut::fieldName(Field field)
+{
+    return (field >= 0 && field < FIELD_COUNT) ? QString::fromLatin1(_fieldNames[field]) : QString();
+}
+
+void Dut::setFlag(Field field, bool on)
+{
+    if (on)
+        flags |= 1u << (field - FIRST_FLAG);
+    else
+        flags &= ~(1u << (field - FIRST_FLAG));
+}
+
+void Dut::addError(const QString &text)
+{
+    if (!text.isEmpty())
+        errors.append(_internError(text));
+}
+
+QStringList Dut::errorList() const
+{
+    return errors;
+}
+
+QString Dut::errorText() const
+{
+    QString text;
+
+    for (auto & error : errors)
+        text += ";" + error;
+
+    return text;
+}
+
+QVariant Dut::value(Field field) const
+{
+    switch (field)
+    {
+        case State:
+            return state;
+        case Id:
+            return id;
+        case No:
+            return no;
+        case Error:
+            return errorText();
+        default:
+            break;
+    }
+
+    if (field >= FIRST_FLAG && field < FIRST_FLAG + FLAG_COUNT)
+        return flag(field);
+
+    if (field >= FIRST_MEASUREMENT && field < FIRST_MEASUREMENT + MEASUREMENT_COUNT)
+        return measurements[field - FIRST_MEASUREMENT];
+
+    return QVariant();
+}
+
+void Dut::setValue(Field field, const QVariant &value)
+{
+    switch (field)
+    {
+        case State:
+            state = value.toInt();
+            return;
+        case Id:
+            id = value.toString();
+            return;
+        case No:
+            no = value.toInt();
+            return;
+        case Error:
+            errors.clear();
+            for (auto & error : value.toString().split(';', QString::SkipEmptyParts))
+                addError(error);
+            return;
+        default:
+            break;
+    }
+
+    if (field >= FIRST_FLAG && field < FIRST_FLAG + FLAG_COUNT)
+        setFlag(field, value.toBool());
+    else if (field >= FIRST_MEASUREMENT && field < FIRST_MEASUREMENT + MEASUREMENT_COUNT)
+        measurements[field - FIRST_MEASUREMENT] = value.toDouble();
+}
+
+QVariant Dut::property(const QString &name) const
+{
+    Field field = Dut::field(name);
+
+    return (Extra == field) ? extra.value(name) : value(field);
+}
+
+Dut::Field Dut::setProperty(const QString &name, const QVariant &value)
+{
+    Field field = Dut::field(name);
+
+    if (Extra == field)
+        extra.insert(name, value);
+    else
+        setValue(field, value);
+
+    return field;
+}
+
+QVariantMap Dut::toVariantMap() const
+{
+    QVariantMap map = extra;
+
+    for (int i = 0; i < FIELD_COUNT; ++i)
+        map.insert(QString::fromLatin1(_fieldNames[i]), value((Field)i));
+
+    return map;
+}
@@ -1,27 +1,83 @@
 #pragma once
 
 #include <QVariant>
+#include <QVector>
+#include <QStringList>
+#include <QMetaType>
 
 enum DutState {inactive, untested, tested, warning};
 
-using Dut = QMap<QString, QVariant>;
-
-static Dut dutTemplate {
-    {"state", DutState::inactive},
-    {"id", ""},
-    {"no", 0},
-    {"railtestDownloaded", false},
-    {"checked", false},
-    {"voltageChecked", false},
-    {"accelChecked", false},
-    {"lightSensChecked", false},
-    {"daliChecked", false},
-    {"radioChecked", false},
-    {"gnssChecked", false},
-    {"rtcChecked", false},
-    {"error", ""}
+// DUT state with typed fields. Scripts reach it by the property names through
+// property()/setProperty(), the GUI gets the changed fields as fieldBit() masks.
+struct Dut
+{
+    enum Field
+    {
+        State,
+        Id,
+        No,
+        Error,
+
+        // Flags
+        Checked,
+        RailtestDownloaded,
+        VoltageChecked,
+        AccelChecked,
+        LightSensChecked,
+        DaliChecked,
+        RadioChecked,
+        GnssChecked,
+        RtcChecked,
+        DinChecked,
+
+        // Measurements
+        Current,
+        Voltage,
+        Rssi,
+        Packets,
+
+        FIELD_COUNT,
+        Extra = FIELD_COUNT                     // Script defined property without a typed field
+    };
+
+    static constexpr int FIRST_FLAG = Checked;
+    static constexpr int FLAG_COUNT = DinChecked - Checked + 1;
+    static constexpr int FIRST_MEASUREMENT = Current;
+    static constexpr int MEASUREMENT_COUNT = Packets - Current + 1;
+
+    int state = DutState::inactive;
+    int no = 0;
+    quint32 flags = 0;
+    double measurements[MEASUREMENT_COUNT] = {};
+    QString id;
+    QStringList errors;                         // Share the text data of the interned error table
+    QVariantMap extra;
+
+    static quint32 fieldBit(Field field) {return 1u << field;}
+
+    bool flag(Field field) const {return flags & (1u << (field - FIRST_FLAG));}
+    void setFlag(Field field, bool on);
+
+    void addError(const QString &text);
+    QString errorText() const;                  // ";" before every error, as the reports expect
+    QStringList errorList() const;
+
+    QVariant value(Field field) const;
+    void setValue(Field field, const QVariant &value);
+
+    // Script facade. Unknown names go to the extra properties and resolve to Extra.
+    QVariant property(const QString &name) const;
+    Field setProperty(const QString &name, const QVariant &value);
+    QVariantMap toVariantMap() const;
+
+    static Field field(const QString &name);
+    static QString fieldName(Field field);
 };
 
+static_assert(Dut::FIELD_COUNT <= 32, "Dut::fieldBit() masks are 32 bit");
+
+Q_DECLARE_METATYPE(Dut)
+
 struct DutRecord
 {
     QString runningNumber;
@@ -49,7 +49,7 @@ DutInfoWidget::DutInfoWidget(SessionManager *session, QWidget *parent) : QWidget
 
     for (int no = 1; no < 16; no++)
     {
-        _duts.insert(no, dutTemplate);
+        _duts.insert(no, Dut());
     }
 }
 
@@ -61,10 +61,10 @@ void DutInfoWidget::showDutInfo(int no)
     auto dut = _duts[no];
 
     _slot->setText(_slotTemplate.arg(no));
-    _id->setText(_idTemplate.arg(dut["id"].toString()));
+    _id->setText(_idTemplate.arg(dut.id));
 
     QString stateDescription;
-    switch (dut["state"].toInt())
+    switch (dut.state)
     {
         case DutState::inactive:
         stateDescription = "The device is not avaliable now.";
@@ -86,17 +86,19 @@ void DutInfoWidget::showDutInfo(int no)
 
     _status->setText(_statusTemplate.arg(stateDescription));
 
-//    if(!dut->getErrorList().isEmpty())
-//    {
-//        _errorDesc->setText(_errorDescTemplate.arg(dut->getErrorList().last()));
-//    }
+    QString errorText = _errorTexts.value(no);
 
-//    else
-//    {
-//        _errorDesc->setText("");
-//    }
+    if(!errorText.isEmpty())
+    {
+        _errorDesc->setText(_errorDescTemplate.arg(errorText.section(';', -1)));
+    }
+
+    else
+    {
+        _errorDesc->setText("");
+    }
 
-    if(dut["checked"].toBool())
+    if(dut.flag(Dut::Checked))
     {
         _checkState->setText("CHECKED for a further testing.");
     }
@@ -107,14 +109,30 @@ void DutInfoWidget::showDutInfo(int no)
     }
 }
 
-void DutInfoWidget::updateDut(Dut dut)
+void DutInfoWidget::updateDut(int no, quint32 fields, const QVariantList &values)
 {
     QMutexLocker locker(&_updateMutex);
-    _duts[dut["no"].toInt()] = dut;
-    showDutInfo(dut["no"].toInt());
+    Dut &shown = _duts[no];
+    int index = 0;
+
+    for (int field = 0; field < Dut::FIELD_COUNT && index < values.size(); ++field)
+    {
+        if (!(fields & Dut::fieldBit((Dut::Field)field)))
+            continue;
+
+        const QVariant &value = values.at(index++);
+
+        // Shown as is, setValue() would intern every joined error text
+        if (Dut::Error == field)
+            _errorTexts[no] = value.toString();
+        else
+            shown.setValue((Dut::Field)field, value);
+    }
+
+    showDutInfo(no);
 }
 
 void DutInfoWidget::setDutChecked(int no, bool checked)
 {
-    _duts[no]["checked"] = checked;
+    _duts[no].setFlag(Dut::Checked, checked);
 }
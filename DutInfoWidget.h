@@ -4,6 +4,7 @@
 #include <QLabel>
 #include <QSharedPointer>
 #include <QMutexLocker>
+#include <QHash>
 
 #include "DutButton.h"
 #include "SessionManager.h"
@@ -20,7 +21,7 @@ public:
 public slots:
 
     void showDutInfo(int no);
-    void updateDut(Dut dut);
+    void updateDut(int no, quint32 fields, const QVariantList &values);
     void setDutChecked(int no, bool checked);
 
 private:
@@ -44,4 +45,5 @@ private:
     QLabel* _checkState;
 
     QMap<int, Dut> _duts;
+    QHash<int, QString> _errorTexts;            // ";" separated, see Dut::errorText()
 };
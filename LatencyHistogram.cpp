@@ -0,0 +1,100 @@
+#include "LatencyHistogram.h"
+
+#include <QStringList>
+#include <QtAlgorithms>
+
+#include <string.h>
+
+int LatencyHistogram::bucket(qint64 usecs)
+{
+    if (usecs < SUB_BUCKETS)
+        return usecs < 0 ? 0 : int(usecs);
+
+    int exponent = 63 - qCountLeadingZeroBits(quint64(usecs));       // >= 3
+    int sub = int(usecs >> (exponent - 3)) & (SUB_BUCKETS - 1);
+    int index = (exponent - 2) * SUB_BUCKETS + sub;
+
+    return qMin(index, BUCKETS - 1);
+}
+
+qint64 LatencyHistogram::bucketLimit(int bucket)
+{
+    if (bucket < SUB_BUCKETS)
+        return bucket + 1;
+
+    int exponent = bucket / SUB_BUCKETS + 2;
+    int sub = bucket % SUB_BUCKETS;
+
+    return qint64(SUB_BUCKETS + sub + 1) << (exponent - 3);
+}
+
+void LatencyHistogram::add(qint64 usecs)
+{
+    int index = bucket(usecs);
+
+    if (_buckets[index] >= MAX_COUNT)
+    {
+        _count = 0;
+        for (auto & count : _buckets)
+        {
+            count /= 2;
+            _count += count;
+        }
+    }
+
+    ++_buckets[index];
+    ++_count;
+}
+
+void LatencyHistogram::clear()
+{
+    memset(_buckets, 0, sizeof(_buckets));
+    _count = 0;
+}
+
+qint64 LatencyHistogram::percentile(double p) const
+{
+    if (_count == 0)
+        return 0;
+
+    quint64 rank = quint64(qBound(0.0, p, 100.0) / 100.0 * (_count - 1)) + 1;
+    quint64 seen = 0;
+
+    for (int i = 0; i < BUCKETS; ++i)
+    {
+        seen += _buckets[i];
+        if (seen >= rank)
+            return bucketLimit(i);
+    }
+
+    return bucketLimit(BUCKETS - 1);
+}
+
+QString LatencyHistogram::toString() const
+{
+    QStringList items;
+
+    for (int i = 0; i < BUCKETS; ++i)
+        if (_buckets[i])
+            items.append(QString("%1:%2").arg(i).arg(_buckets[i]));
+
+    return items.join(',');
+}
+
+void LatencyHistogram::fromString(const QString &text)
+{
+    clear();
+
+    for (auto & item : text.split(',', QString::SkipEmptyParts))
+    {
+        int idx = item.indexOf(':');
+        int index = item.left(idx).toInt();
+        quint32 count = item.mid(idx + 1).toUInt();
+
+        if (idx > 0 && index >= 0 && index < BUCKETS)
+        {
+            _buckets[index] = qMin(count, quint32(MAX_COUNT));
+            _count += _buckets[index];
+        }
+    }
+}
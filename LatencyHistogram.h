@@ -0,0 +1,40 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <QString>
+#include <QtGlobal>
+
+// Log-linear latency histogram: 8 buckets per power of two, i.e. 12.5% resolution
+// from 1 us up to minutes. Fixed size, adding a sample does not allocate.
+class LatencyHistogram
+{
+public:
+
+    static constexpr int SUB_BUCKETS = 8;
+    static constexpr int BUCKETS = 27 * SUB_BUCKETS;
+    static constexpr quint32 MAX_COUNT = 100000;         // Counts are halved beyond it, so old samples fade out
+
+    LatencyHistogram() {clear();}
+
+    void add(qint64 usecs);
+    void clear();
+
+    quint64 count() const {return _count;}
+
+    // Upper bound of the bucket holding the percentile (0..100), 0 when empty.
+    qint64 percentile(double p) const;
+
+    // Compact text form "bucket:count,..." for the settings.
+    QString toString() const;
+    void fromString(const QString &text);
+
+    static int bucket(qint64 usecs);
+    static qint64 bucketLimit(int bucket);
+
+private:
+
+    quint32 _buckets[BUCKETS];
+    quint64 _count;
+};
+
+#endif // LATENCYHISTOGRAM_H
@@ -0,0 +1,117 @@
+#include "LinkTrace.h"
+
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+static const char _magic[4] = {'M', 'B', 'L', 'T'};
+
+bool LinkTraceWriter::open(const QString &path)
+{
+    close();
+
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+    {
+        qCritical() << "Link trace. Cannot create" << path << _file.errorString();
+
+        return false;
+    }
+
+    uchar header[LinkTrace::HEADER_SIZE];
+
+    memcpy(header, _magic, sizeof(_magic));
+    qToLittleEndian<quint16>(LinkTrace::VERSION, header + 4);
+    qToLittleEndian<quint16>(0, header + 6);
+    qToLittleEndian<qint64>(QDateTime::currentMSecsSinceEpoch(), header + 8);
+    _file.write((const char*)header, sizeof(header));
+    _clock.start();
+
+    return true;
+}
+
+void LinkTraceWriter::close()
+{
+    if (_file.isOpen())
+        _file.close();
+}
+
+void LinkTraceWriter::write(LinkTrace::Direction direction, const char *data, int size)
+{
+    if (!_file.isOpen() || size <= 0)
+        return;
+
+    uchar header[LinkTrace::RECORD_HEADER_SIZE];
+
+    qToLittleEndian<quint64>(_clock.nsecsElapsed() / 1000, header);
+    qToLittleEndian<quint32>(quint32(size) | (LinkTrace::Tx == direction ? LinkTrace::TX_FLAG : 0), header + 8);
+    _file.write((const char*)header, sizeof(header));
+    _file.write(data, size);
+}
+
+bool LinkTraceReader::open(const QString &path)
+{
+    close();
+
+    _file.setFileName(path);
+    if (!_file.open(QIODevice::ReadOnly))
+    {
+        qCritical() << "Link trace. Cannot open" << path << _file.errorString();
+
+        return false;
+    }
+
+    _size = _file.size();
+    _map = _size >= LinkTrace::HEADER_SIZE ? _file.map(0, _size) : nullptr;
+
+    if (!_map || memcmp(_map, _magic, sizeof(_magic)) != 0 || qFromLittleEndian<quint16>(_map + 4) != LinkTrace::VERSION)
+    {
+        qCritical() << "Link trace. Not a link trace:" << path;
+        close();
+
+        return false;
+    }
+
+    _startTime = QDateTime::fromMSecsSinceEpoch(qFromLittleEndian<qint64>(_map + 8));
+    rewind();
+
+    return true;
+}
+
+void LinkTraceReader::close()
+{
+    if (_map)
+        _file.unmap(const_cast<uchar*>(_map));
+
+    _map = nullptr;
+    _size = _pos = 0;
+
+    if (_file.isOpen())
+        _file.close();
+}
+
+bool LinkTraceReader::next(Record *record)
+{
+    if (!_map || _pos + LinkTrace::RECORD_HEADER_SIZE > _size)
+        return false;
+
+    const uchar *header = _map + _pos;
+    quint32 sizeAndFlags = qFromLittleEndian<quint32>(header + 8);
+    qint64 size = sizeAndFlags & ~LinkTrace::TX_FLAG;
+
+    if (_pos + LinkTrace::RECORD_HEADER_SIZE + size > _size)
+    {
+        qWarning() << "Link trace. Truncated record at" << _pos;
+
+        return false;
+    }
+
+    record->usecs = (qint64)qFromLittleEndian<quint64>(header);
+    record->direction = (sizeAndFlags & LinkTrace::TX_FLAG) ? LinkTrace::Tx : LinkTrace::Rx;
+    record->data = (const char*)header + LinkTrace::RECORD_HEADER_SIZE;
+    record->size = (int)size;
+    _pos += LinkTrace::RECORD_HEADER_SIZE + size;
+
+    return true;
+}
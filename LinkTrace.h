@@ -0,0 +1,79 @@
+#ifndef LINKTRACE_H
+#define LINKTRACE_H
+
+#include <QFile>
+#include <QDateTime>
+#include <QElapsedTimer>
+
+// Raw measuring board link trace.
+//
+// File layout, little endian, no padding, so a mapped file is read in place:
+//   header: "MBLT", quint16 version, quint16 reserved, qint64 start time (ms since epoch)
+//   record: quint64 usecs since the start (monotonic), quint32 size | TX flag, size bytes of SLIP data
+class LinkTrace
+{
+public:
+
+    enum Direction {Rx, Tx};
+
+    static constexpr quint16 VERSION = 1;
+    static constexpr int HEADER_SIZE = 16;
+    static constexpr int RECORD_HEADER_SIZE = 12;
+    static constexpr quint32 TX_FLAG = 0x80000000;
+};
+
+class LinkTraceWriter
+{
+public:
+
+    LinkTraceWriter() {}
+    ~LinkTraceWriter() {close();}
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const {return _file.isOpen();}
+    QString fileName() const {return _file.fileName();}
+
+    void write(LinkTrace::Direction direction, const char *data, int size);
+
+private:
+
+    QFile _file;
+    QElapsedTimer _clock;
+};
+
+class LinkTraceReader
+{
+public:
+
+    struct Record
+    {
+        qint64 usecs;
+        LinkTrace::Direction direction;
+        const char *data;                       // Points into the mapped file
+        int size;
+    };
+
+    LinkTraceReader() {}
+    ~LinkTraceReader() {close();}
+
+    bool open(const QString &path);
+    void close();
+    bool isOpen() const {return _map != nullptr;}
+
+    QDateTime startTime() const {return _startTime;}
+
+    // Sequential access. Returns false at the end of the trace or on a truncated record.
+    bool next(Record *record);
+    void rewind() {_pos = LinkTrace::HEADER_SIZE;}
+
+private:
+
+    QFile _file;
+    const uchar *_map = nullptr;
+    qint64 _size = 0;
+    qint64 _pos = 0;
+    QDateTime _startTime;
+};
+
+#endif // LINKTRACE_H
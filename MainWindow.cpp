@@ -8,14 +8,16 @@
 #include <QHBoxLayout>
 #include <QFormLayout>
 #include <QCompleter>
-#include <QSerialPortInfo>
 #include <QMessageBox>
 #include <QCloseEvent>
 
+#include "Station.h"
+
 MainWindow::MainWindow(QWidget *parent)
     : QWidget(parent)
 {
     thread()->setObjectName("Main Window thread");
+    qRegisterMetaType<Dut>("Dut");
     setStyleSheet("color: #424242; font-size:10pt;");    
 
     _settings = QSharedPointer<QSettings>::create(_workDirectory + "/settings.ini", QSettings::IniFormat);
@@ -28,7 +30,7 @@ MainWindow::MainWindow(QWidget *parent)
     _methodManager = new TestMethodManager(_settings);
     _methodManager->setLogger(_logger);
 
-    auto availablePorts = QSerialPortInfo::availablePorts();
+    PortRegistry::instance()->start(_settings->value("TestBoard/portPollInterval", 2000).toInt());
 
     //Setting number of active measuring boards (max - 5)
     const int MAX_MEASBOARD_COUNT = 5;
@@ -77,6 +79,8 @@ MainWindow::MainWindow(QWidget *parent)
         }
     }
 
+    _methodManager->scriptEngine()->globalObject().setProperty("radioScheduler", _methodManager->scriptEngine()->newQObject(new RadioScheduler(this)));
+
 //--- GUI Layouts---
     QVBoxLayout* mainLayout = new QVBoxLayout;
     setLayout(mainLayout);
@@ -518,11 +522,7 @@ void MainWindow::setControlsEnabled(bool state)
 
 void MainWindow::delay(int msec)
 {
-    QTime expire = QTime::currentTime().addMSecs(msec);
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-    }
+    Station::wait(msec);
 }
 
 Dut MainWindow::getDut(int no)
@@ -531,12 +531,12 @@ Dut MainWindow::getDut(int no)
     {
         for(auto & dut : testClient->getDuts())
         {
-            if(dut["no"].toInt() == no)
+            if(dut.no == no)
                 return dut;
         }
     }
 
-    return dutTemplate;
+    return Dut();
 }
 
 void MainWindow::closeEvent(QCloseEvent *event)
@@ -18,6 +18,7 @@
 #include "Logger.h"
 #include "JLinkManager.h"
 #include "TestClient.h"
+#include "RadioScheduler.h"
 #include "TestFixtureWidget.h"
 #include "SessionInfoWidget.h"
 #include "DutInfoWidget.h"
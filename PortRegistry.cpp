@@ -0,0 +1,141 @@
+#include "PortRegistry.h"
+
+#include <QCoreApplication>
+#include <QSerialPortInfo>
+#include <QSocketNotifier>
+#include <QDebug>
+
+#ifdef Q_OS_LINUX
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <unistd.h>
+#include <string.h>
+#endif
+
+PortRegistry *PortRegistry::instance()
+{
+    // Owned by the application, so its timers go away before the event dispatcher.
+    static PortRegistry *registry = new PortRegistry(QCoreApplication::instance());
+
+    return registry;
+}
+
+PortRegistry::PortRegistry(QObject *parent) : QObject(parent), _pollTimer(this), _ueventTimer(this)
+{
+    _ueventTimer.setSingleShot(true);
+
+    connect(&_pollTimer, &QTimer::timeout, this, &PortRegistry::refresh);
+    connect(&_ueventTimer, &QTimer::timeout, this, &PortRegistry::refresh);
+}
+
+PortRegistry::~PortRegistry()
+{
+#ifdef Q_OS_LINUX
+    if (_ueventFd >= 0)
+        ::close(_ueventFd);
+#endif
+}
+
+void PortRegistry::start(int pollInterval)
+{
+    refresh();
+
+    if (_ueventNotifier || _pollTimer.isActive())
+        return;
+
+    if (openUevents())
+        return;
+
+    _pollTimer.start(pollInterval);
+}
+
+bool PortRegistry::openUevents()
+{
+#ifdef Q_OS_LINUX
+    _ueventFd = ::socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+
+    sockaddr_nl address;
+
+    memset(&address, 0, sizeof(address));
+    address.nl_family = AF_NETLINK;
+    address.nl_groups = 1;                      // Kernel events
+
+    if (_ueventFd >= 0 && ::bind(_ueventFd, (sockaddr*)&address, sizeof(address)) == 0)
+    {
+        _ueventNotifier = new QSocketNotifier(_ueventFd, QSocketNotifier::Read, this);
+        connect(_ueventNotifier, &QSocketNotifier::activated, this, &PortRegistry::onUevent);
+
+        return true;
+    }
+
+    qWarning() << "Port registry. No kernel uevents, polling the serial ports.";
+    if (_ueventFd >= 0)
+        ::close(_ueventFd);
+    _ueventFd = -1;
+#endif
+
+    return false;
+}
+
+QString PortRegistry::portName(const QString &serialNumber) const
+{
+    QReadLocker locker(&_lock);
+
+    return _ports.value(serialNumber);
+}
+
+QStringList PortRegistry::serialNumbers() const
+{
+    QReadLocker locker(&_lock);
+
+    return _ports.keys();
+}
+
+void PortRegistry::refresh()
+{
+    QHash<QString, QString> ports;
+
+    for (auto & portInfo : QSerialPortInfo::availablePorts())
+        if (!portInfo.serialNumber().isEmpty())
+            ports.insert(portInfo.serialNumber(), portInfo.portName());
+
+    QHash<QString, QString> previous;
+    {
+        QWriteLocker locker(&_lock);
+
+        previous = _ports;
+        if (previous == ports)
+            return;
+
+        _ports = ports;
+    }
+
+    for (auto it = previous.constBegin(); it != previous.constEnd(); ++it)
+        if (ports.value(it.key()) != it.value())
+            emit portDetached(it.key(), it.value());
+
+    for (auto it = ports.constBegin(); it != ports.constEnd(); ++it)
+        if (previous.value(it.key()) != it.value())
+            emit portAttached(it.key(), it.value());
+}
+
+void PortRegistry::onUevent()
+{
+#ifdef Q_OS_LINUX
+    char buffer[4096];
+    bool ttyEvent = false;
+    ssize_t size;
+
+    // "ACTION@DEVPATH\0KEY=VALUE\0..."
+    while ((size = ::recv(_ueventFd, buffer, sizeof(buffer) - 1, 0)) > 0)
+    {
+        buffer[size] = 0;
+        for (const char *item = buffer; item < buffer + size; item += strlen(item) + 1)
+            if (strcmp(item, "SUBSYSTEM=tty") == 0)
+                ttyEvent = true;
+    }
+
+    if (ttyEvent)
+        _ueventTimer.start(200);
+#endif
+}
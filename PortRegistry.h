@@ -0,0 +1,58 @@
+#ifndef PORTREGISTRY_H
+#define PORTREGISTRY_H
+
+#include <QObject>
+#include <QHash>
+#include <QStringList>
+#include <QReadWriteLock>
+#include <QTimer>
+
+class QSocketNotifier;
+
+// Process-wide serial port list indexed by the USB serial number.
+// Refreshed on the kernel tty uevents on Linux and by polling elsewhere, so lookups
+// do not enumerate the ports. Lookups are thread-safe, signals come from the owner thread.
+class PortRegistry : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    static PortRegistry *instance();
+
+    // Starts watching. The first call must come from the main thread.
+    void start(int pollInterval = 2000);
+
+    // System port name by the USB serial number, empty if the port is not attached.
+    QString portName(const QString &serialNumber) const;
+    QStringList serialNumbers() const;
+
+public slots:
+
+    void refresh();
+
+signals:
+
+    void portAttached(const QString &serialNumber, const QString &portName);
+    void portDetached(const QString &serialNumber, const QString &portName);
+
+private slots:
+
+    void onUevent();
+
+private:
+
+    explicit PortRegistry(QObject *parent = nullptr);
+    ~PortRegistry();
+
+    bool openUevents();
+
+    mutable QReadWriteLock _lock;
+    QHash<QString, QString> _ports;             // Serial number -> port name
+    QTimer _pollTimer;
+    QTimer _ueventTimer;                        // Lets udev finish with the device node
+    int _ueventFd = -1;
+    QSocketNotifier *_ueventNotifier = nullptr;
+};
+
+#endif // PORTREGISTRY_H
@@ -0,0 +1,79 @@
+#include "PowerSampler.h"
+
+static inline void _keepMin(qint32 &target, qint32 value)
+{
+    if (target < 0 || value < target)
+        target = value;
+}
+
+bool PowerSampler::push(const Sample &sample)
+{
+    quint32 head = _head.load(std::memory_order_relaxed);
+
+    if (head - _tail.load(std::memory_order_acquire) >= quint32(CAPACITY))
+    {
+        _dropped.fetch_add(1, std::memory_order_relaxed);
+
+        return false;
+    }
+
+    _ring[head & (CAPACITY - 1)] = sample;
+    _head.store(head + 1, std::memory_order_release);
+
+    return true;
+}
+
+void PowerSampler::drain()
+{
+    quint32 tail = _tail.load(std::memory_order_relaxed);
+    quint32 head = _head.load(std::memory_order_acquire);
+    qint64 maxGap = _maxGap.load(std::memory_order_relaxed);
+
+    for (; tail != head; ++tail)
+    {
+        const Sample &sample = _ring[tail & (CAPACITY - 1)];
+        Profile &profile = _profiles[sample.slot < SLOTS ? sample.slot : 0];
+
+        ++profile.samples;
+
+        if (Rail24V == sample.rail)
+        {
+            _keepMin(profile.min24V, sample.value);
+            continue;
+        }
+
+        if (Rail3V == sample.rail)
+        {
+            _keepMin(profile.min3V, sample.value);
+            continue;
+        }
+
+        // The current between two samples is charged to the slot active at the first one.
+        qint64 gap = sample.usecs - _lastUsecs;
+
+        if (_lastUsecs >= 0 && gap > 0 && gap <= maxGap)
+            _profiles[_lastSlot].charge += _lastCurrent * (gap / 1000000.0);
+
+        _lastUsecs = sample.usecs;
+        _lastCurrent = sample.value;
+        _lastSlot = sample.slot < SLOTS ? sample.slot : 0;
+
+        if (sample.value > profile.peakCurrent)
+        {
+            profile.peakCurrent = sample.value;
+            profile.peakStep = sample.step;
+        }
+    }
+
+    _tail.store(tail, std::memory_order_release);
+}
+
+void PowerSampler::clear()
+{
+    drain();
+
+    for (auto & profile : _profiles)
+        profile = Profile();
+    _lastUsecs = -1;
+    _dropped.store(0, std::memory_order_relaxed);
+}
@@ -0,0 +1,72 @@
+#ifndef POWERSAMPLER_H
+#define POWERSAMPLER_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+// Measuring board supply samples taken in the background and tagged with the DUT slot and
+// the test step active at the time. The sampling thread pushes into a single producer,
+// single consumer ring; the script side drains it into the per-slot figures.
+//
+// The CSA current is the supply of the whole measuring board. All of it is charged to the
+// slot active at the sample, so the per-slot charge and peak are right only while the other
+// slots are powered off; with several DUTs powered they also hold the others' current.
+class PowerSampler
+{
+public:
+
+    enum Rail {Current, Rail24V, Rail3V};
+
+    struct Sample
+    {
+        qint64 usecs;
+        qint32 value;                           // CSA current (mA) or raw rail ADC value
+        quint8 rail;
+        quint8 slot;                            // 0 - no active slot
+        quint16 step;
+    };
+
+    struct Profile
+    {
+        quint64 samples = 0;
+        double charge = 0.0;                    // mA*s
+        qint32 peakCurrent = -1;
+        int peakStep = -1;
+        qint32 min24V = -1;
+        qint32 min3V = -1;
+    };
+
+    static constexpr int CAPACITY = 4096;       // Power of two
+    static constexpr int SLOTS = 4;
+
+    PowerSampler() {}
+
+    // Producer side. Returns false and drops the sample when the ring is full.
+    bool push(const Sample &sample);
+
+    // Consumer side.
+    void drain();
+    void clear();
+    const Profile &profile(int slot) const {return _profiles[(slot >= 0 && slot < SLOTS) ? slot : 0];}
+    quint64 dropped() const {return _dropped.load(std::memory_order_relaxed);}
+
+    // Longer gaps between current samples are not integrated, e.g. while the port was busy.
+    // Any thread.
+    void setMaxGap(qint64 usecs) {_maxGap.store(usecs, std::memory_order_relaxed);}
+
+private:
+
+    Sample _ring[CAPACITY];
+    std::atomic<quint32> _head {0};             // Written by the producer
+    std::atomic<quint32> _tail {0};             // Written by the consumer
+    std::atomic<quint64> _dropped {0};
+
+    Profile _profiles[SLOTS];
+    std::atomic<qint64> _maxGap {1000000};      // Set by the sampling thread
+    qint64 _lastUsecs = -1;
+    qint32 _lastCurrent = 0;
+    int _lastSlot = 0;
+};
+
+#endif // POWERSAMPLER_H
@@ -0,0 +1,149 @@
+#include "RadioScheduler.h"
+
+#include <QEventLoop>
+#include <QDebug>
+
+#include "TestClient.h"
+
+RadioScheduler::RadioScheduler(QObject *parent) : QObject(parent)
+{
+}
+
+void RadioScheduler::run(const QVariantList &modules, const QVariantList &channels, const QVariantList &jobs,
+                         int minRSSI, int maxRSSI, int count, int attempts)
+{
+    if (_loop)
+    {
+        qCritical() << "Radio scheduler. The radio tests are running already.";
+
+        return;
+    }
+
+    if (modules.isEmpty() || channels.isEmpty())
+    {
+        qCritical() << "Radio scheduler. No reference modules or channels.";
+
+        return;
+    }
+
+    QVector<TestClient*> testClients;
+
+    _jobs.clear();
+    for (auto & item : jobs)
+    {
+        QVariantMap job = item.toMap();
+        TestClient *testClient = qobject_cast<TestClient*>(job.value("testClient").value<QObject*>());
+
+        if (!testClient)
+        {
+            qWarning() << "Radio scheduler. Job without a test client:" << job;
+            continue;
+        }
+
+        // Passed in an earlier run
+        if (testClient->dutProperty(job.value("slot").toInt(), "radioChecked").toBool())
+            continue;
+
+        _jobs.append({testClient, job.value("slot").toInt(), job.value("power").toInt(), 0});
+        if (!testClients.contains(testClient))
+            testClients.append(testClient);
+    }
+
+    _next = 0;
+    _busy = 0;
+    _minRSSI = minRSSI;
+    _maxRSSI = maxRSSI;
+    _count = count;
+    _attempts = qMax(1, attempts);
+
+    _lanes.clear();
+    for (int i = 0; i < modules.size() && _lanes.size() < _jobs.size(); i++)
+    {
+        int channel = channels.at(i % channels.size()).toInt();
+        bool used = false;
+
+        for (auto & lane : _lanes)
+            used = used || lane.channel == channel;
+
+        if (!used)
+            _lanes.append({modules.at(i).toString(), channel, -1});
+    }
+
+    // The results come back as events of this thread, also from the test clients living here.
+    for (auto testClient : testClients)
+        connect(testClient, &TestClient::radioTested, this, &RadioScheduler::onRadioTested, Qt::QueuedConnection);
+
+    for (int lane = 0; lane < _lanes.size(); lane++)
+        dispatch(lane);
+
+    if (_busy > 0)
+    {
+        QEventLoop loop;
+
+        _loop = &loop;
+        loop.exec();
+        _loop = nullptr;
+    }
+
+    for (auto testClient : testClients)
+        disconnect(testClient, &TestClient::radioTested, this, &RadioScheduler::onRadioTested);
+}
+
+void RadioScheduler::onRadioTested(int slot, bool passed)
+{
+    TestClient *testClient = qobject_cast<TestClient*>(sender());
+
+    for (int lane = 0; lane < _lanes.size(); lane++)
+    {
+        int index = _lanes.at(lane).job;
+
+        if (index < 0 || _jobs.at(index).testClient != testClient || _jobs.at(index).slot != slot)
+            continue;
+
+        --_busy;
+        if (!passed && _jobs.at(index).attempts < _attempts)
+            start(lane);
+        else
+            dispatch(lane);
+
+        break;
+    }
+
+    if (0 == _busy && _loop)
+        _loop->quit();
+}
+
+void RadioScheduler::dispatch(int lane)
+{
+    if (_next >= _jobs.size())
+    {
+        _lanes[lane].job = -1;
+
+        return;
+    }
+
+    _lanes[lane].job = _next++;
+    start(lane);
+}
+
+void RadioScheduler::start(int lane)
+{
+    const Lane &module = _lanes.at(lane);
+    Job &job = _jobs[module.job];
+
+    // In the thread of the test client, which owns the measuring board port.
+    ++job.attempts;
+    ++_busy;
+    if (!QMetaObject::invokeMethod(job.testClient, "testRadio", Qt::QueuedConnection,
+                                   Q_ARG(int, job.slot), Q_ARG(QString, module.module), Q_ARG(int, module.channel),
+                                   Q_ARG(int, job.power), Q_ARG(int, _minRSSI), Q_ARG(int, _maxRSSI), Q_ARG(int, _count)))
+    {
+        // The DUT fails, the lane goes on with the next one.
+        qCritical() << "Radio scheduler. Cannot start the radio test of slot" << job.slot;
+        job.testClient->setDutProperty(job.slot, "radioChecked", false);
+        job.testClient->addDutError(job.slot, "Radio Interface failure: the test cannot be started.");
+        --_busy;
+        _lanes[lane].job = -1;
+        dispatch(lane);
+    }
+}
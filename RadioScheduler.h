@@ -0,0 +1,69 @@
+#ifndef RADIOSCHEDULER_H
+#define RADIOSCHEDULER_H
+
+#include <QObject>
+#include <QVariant>
+#include <QVector>
+
+class QEventLoop;
+class TestClient;
+
+// Runs the radio tests of the station on several reference modules at once. Each module
+// takes the next waiting DUT when it is free; the DUT transmits on the channel of its module.
+// The tests run in the threads of their test clients, so boards in their own threads test in
+// parallel; the reference modules are driven from their threads, see ReferenceRadio.
+class RadioScheduler : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit RadioScheduler(QObject *parent = nullptr);
+
+public slots:
+
+    // modules - reference module serial numbers, channels - BLE channels given to the modules
+    // in turn, jobs - {testClient, slot, power} maps. Modules sharing a channel would hear each
+    // other's DUTs, so as many modules work at once as there are distinct channels. A DUT gets
+    // up to attempts tests until it passes. Returns when all the jobs are done, the calling
+    // thread keeps processing its events meanwhile.
+    void run(const QVariantList &modules, const QVariantList &channels, const QVariantList &jobs,
+             int minRSSI, int maxRSSI, int count, int attempts = 3);
+
+private slots:
+
+    void onRadioTested(int slot, bool passed);
+
+private:
+
+    struct Job
+    {
+        TestClient *testClient;
+        int slot;
+        int power;
+        int attempts;
+    };
+
+    // Reference module working on its channel.
+    struct Lane
+    {
+        QString module;
+        int channel;
+        int job;                                // Index in _jobs, -1 - idle
+    };
+
+    void dispatch(int lane);
+    void start(int lane);
+
+    QVector<Job> _jobs;
+    QVector<Lane> _lanes;
+    int _next = 0;
+    int _busy = 0;
+    int _minRSSI = 0;
+    int _maxRSSI = 0;
+    int _count = 0;
+    int _attempts = 0;
+    QEventLoop *_loop = nullptr;
+};
+
+#endif // RADIOSCHEDULER_H
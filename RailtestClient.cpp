@@ -1,13 +1,16 @@
 #include "RailtestClient.h"
 
-#include <QCoreApplication>
-#include <QTime>
+#include <QElapsedTimer>
 
 RailtestClient::RailtestClient(QObject *parent)
-    : QObject(parent)
+    : QObject(parent),
+      m_serial(this)
 {
     connect(&m_serial, &QSerialPort::readyRead, this, &RailtestClient::onSerialPortReadyRead);
     connect(&m_serial, &QSerialPort::errorOccurred, this, &RailtestClient::onSerialPortErrorOccurred);
+
+    m_engine.setRecordHandler([this](const RailtestReply &reply){decodeReply(reply);});
+    m_engine.setPromptHandler([this](){m_syncCommand.clear();});
 }
 
 RailtestClient::~RailtestClient()
@@ -34,7 +37,7 @@ void RailtestClient::close()
     {
         m_serial.flush();
         m_serial.close();
-        m_recvBuffer.clear();
+        m_engine.reset();
     }
 }
 
@@ -44,18 +47,10 @@ bool RailtestClient::waitCommandPrompt(int timeout)
         return false;
 
     m_syncCommand = "__waitCommandPrompt__";
-
-    QTime expire = QTime::currentTime().addMSecs(timeout);
-
     m_serial.write("\r\n");
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-        if (m_syncCommand.isEmpty())
-            return true;
-    }
+    m_serial.flush();
 
-    return false;
+    return wait([this](){return m_syncCommand.isEmpty();}, timeout, -1);
 }
 
 QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray &args, int timeout)
@@ -66,15 +61,10 @@ QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray
     m_syncCommand = cmd;
     m_syncReplies.clear();
 
-    QTime expire = QTime::currentTime().addMSecs(timeout);
-
     m_serial.write(cmd + " " + args + "\r\n");
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-        if (m_syncCommand.isEmpty())
-            return m_syncReplies;
-    }
+    m_serial.flush();
+    if (wait([this](){return m_syncCommand.isEmpty();}, timeout, -1))
+        return m_syncReplies;
 
     QVariantMap error;
 
@@ -85,26 +75,56 @@ QVariantList RailtestClient::syncCommand(const QByteArray &cmd, const QByteArray
     return m_syncReplies;
 }
 
-void RailtestClient::decodeReply(const QByteArray &reply)
+bool RailtestClient::waitFor(const bool &done, int timeout, int idleTimeout)
 {
-    if (reply.startsWith("{{(") && reply.endsWith("}}"))
+    return wait([&done](){return done;}, timeout, idleTimeout);
+}
+
+bool RailtestClient::wait(const std::function<bool()> &done, int timeout, int idleTimeout)
+{
+    QElapsedTimer clock;
+    qint64 lastData = 0;
+
+    // Blocks on the port instead of spinning the event loop, the replies are decoded here.
+    clock.start();
+    while (!done() && m_serial.isOpen())
     {
-        int idx = reply.indexOf(")}");
+        qint64 now = clock.elapsed();
+        qint64 rest = timeout - now;
+
+        if (idleTimeout >= 0)
+            rest = qMin(rest, lastData + idleTimeout - now);
+
+        if (rest <= 0)
+            return false;
+
+        if (m_serial.waitForReadyRead(int(rest)))
+        {
+            onSerialPortReadyRead();
+            lastData = clock.elapsed();
+        }
+        else if (m_serial.error() != QSerialPort::NoError && m_serial.error() != QSerialPort::TimeoutError)
+            break;
+    }
 
-        if (idx == -1)
-            return;
+    return done();
+}
 
-        auto name = reply.mid(3, idx - 3);
-        auto params = reply.mid(idx + 2, reply.length() - idx - 3).split('}');
+void RailtestClient::decodeReply(const RailtestReply &reply)
+{
+    if (reply.records().isEmpty())
+        return;
+
+    const QByteArray &text = reply.text();
+
+    if (reply.records().at(0).commandSize > 0)
+    {
+        auto name = reply.command();
         QVariantMap decodedParams;
 
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-            {
-                idx = param.indexOf(':');
-                if (idx != -1)
-                    decodedParams.insert(param.mid(1, idx - 1), param.mid(idx + 1));
-            }
+        for (auto & item : reply.items())
+            if (item.keySize >= 0)
+                decodedParams.insert(text.mid(item.key, item.keySize), text.mid(item.value, item.valueSize));
 
         if (m_syncCommand == name)
             m_syncReplies.append(decodedParams);
@@ -114,41 +134,23 @@ void RailtestClient::decodeReply(const QByteArray &reply)
         return;
     }
 
-    if (reply.startsWith("{{") && reply.endsWith("}}"))
-    {
-        auto params = reply.mid(1, reply.length() - 2).split('}');
-        QVariantList decodedParams;
-
-        foreach (auto param, params)
-            if (param.startsWith('{'))
-                decodedParams.append(param.mid(1));
+    QVariantList decodedParams;
 
-        if (!m_syncCommand.isEmpty())
-            m_syncReplies.push_back(decodedParams);
+    // Whole item text, "key:value" items included
+    for (auto & item : reply.items())
+        decodedParams.append(text.mid(item.key, item.value + item.valueSize - item.key));
 
-        return;
-    }
+    if (!m_syncCommand.isEmpty())
+        m_syncReplies.push_back(decodedParams);
 }
 
 void RailtestClient::onSerialPortReadyRead() Q_DECL_NOTHROW
 {
-    while (m_serial.bytesAvailable())
-        m_recvBuffer += m_serial.readAll();
-
-    int idx = m_recvBuffer.indexOf("\r\n");
-
-    while (idx != -1)
-    {
-        auto reply = m_recvBuffer.left(idx);
-
-        decodeReply(reply);
-
-        m_recvBuffer = m_recvBuffer.mid(idx + 2);
-        idx = m_recvBuffer.indexOf("\r\n");
-    }
+    char buffer[1024];
+    qint64 size;
 
-    if (m_recvBuffer == "> ")
-        m_syncCommand.clear();
+    while ((size = m_serial.read(buffer, sizeof(buffer))) > 0)
+        m_engine.feed(buffer, (int)size);
 }
 
 void RailtestClient::onSerialPortErrorOccurred(QSerialPort::SerialPortError errorCode) Q_DECL_NOTHROW
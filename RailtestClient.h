@@ -4,6 +4,10 @@
 #include <QSerialPort>
 #include <QVariant>
 
+#include <functional>
+
+#include "RailtestEngine.h"
+
 class RailtestClient : public QObject
 {
     Q_OBJECT
@@ -18,14 +22,18 @@ class RailtestClient : public QObject
         bool waitCommandPrompt(int timeout = 1000);
         QVariantList syncCommand(const QByteArray &cmd, const QByteArray &args = QByteArray(), int timeout = 5000);
 
+        // Processes the received data until the flag is set by a replyReceived() handler,
+        // no data arrives for idleTimeout ms (-1 - no limit) or the timeout expires.
+        bool waitFor(const bool &done, int timeout, int idleTimeout = -1);
+
     private:
         QSerialPort m_serial;
-        QByteArray
-            m_recvBuffer,
-            m_syncCommand;
+        RailtestEngine m_engine;
+        QByteArray m_syncCommand;
         QVariantList m_syncReplies;
 
-        void decodeReply(const QByteArray &reply);
+        void decodeReply(const RailtestReply &reply);
+        bool wait(const std::function<bool()> &done, int timeout, int idleTimeout);
 
     private slots:
         void onSerialPortReadyRead() Q_DECL_NOTHROW;
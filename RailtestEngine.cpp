@@ -0,0 +1,168 @@
+#include "RailtestEngine.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+static constexpr quint32 RING_MASK = RailtestEngine::RING_SIZE - 1;
+
+static_assert((RailtestEngine::RING_SIZE & RING_MASK) == 0, "Ring size must be a power of two");
+
+void RailtestEngine::expect(const QByteArray &command, const ReplyHandler &handler)
+{
+    _expecting = true;
+    _replyStarted = false;
+    _command = command;
+    _reply.clear();
+    _replyHandler = handler;
+}
+
+RailtestReply RailtestEngine::cancel()
+{
+    RailtestReply reply;
+
+    if (_expecting && _replyStarted)
+    {
+        // The unfinished line belongs to the reply as well.
+        for (quint32 i = _head; i != _tail; ++i)
+            _reply.append(_ring[i & RING_MASK]);
+
+        reply = RailtestReply::parse(_reply, false);
+    }
+
+    _expecting = false;
+    _replyStarted = false;
+    _reply.clear();
+    _replyHandler = ReplyHandler();
+
+    return reply;
+}
+
+void RailtestEngine::reset()
+{
+    _head = _scan = _tail = 0;
+    _line.clear();
+    cancel();
+}
+
+void RailtestEngine::feed(const char *data, int size)
+{
+    while (size > 0)
+    {
+        if (_tail - _head == (quint32)RING_SIZE)
+        {
+            qWarning() << "Railtest line is longer than" << RING_SIZE << "bytes, dropped.";
+            _head = _scan = _tail;
+        }
+
+        int chunk = qMin<int>(size, RING_SIZE - (_tail - _head));
+        int pos = _tail & RING_MASK;
+        int first = qMin(chunk, RING_SIZE - pos);
+
+        memcpy(_ring + pos, data, first);
+        memcpy(_ring, data + first, chunk - first);
+        _tail += chunk;
+        data += chunk;
+        size -= chunk;
+
+        // Split the new bytes into lines.
+        while (_scan != _tail)
+        {
+            int scanPos = _scan & RING_MASK;
+            int scanSize = qMin<int>(_tail - _scan, RING_SIZE - scanPos);
+            const char *newLine = (const char*)memchr(_ring + scanPos, '\n', scanSize);
+
+            if (!newLine)
+            {
+                _scan += scanSize;
+                continue;
+            }
+
+            _scan += newLine - (_ring + scanPos) + 1;
+
+            int lineSize = _scan - 1 - _head;
+            int headPos = _head & RING_MASK;
+            const char *line = _ring + headPos;
+
+            if (headPos + lineSize > RING_SIZE)
+            {
+                _line.resize(lineSize);
+                memcpy(_line.data(), _ring + headPos, RING_SIZE - headPos);
+                memcpy(_line.data() + RING_SIZE - headPos, _ring, lineSize - (RING_SIZE - headPos));
+                line = _line.constData();
+            }
+
+            if (lineSize > 0 && line[lineSize - 1] == '\r')
+                --lineSize;
+
+            _head = _scan;
+            onLine(line, lineSize);
+        }
+
+        // The prompt is not terminated by a new line.
+        if (_tail - _head == 2 && _ring[_head & RING_MASK] == '>' && _ring[(_head + 1) & RING_MASK] == ' ')
+        {
+            _head = _scan = _tail;
+            onPrompt();
+        }
+    }
+}
+
+bool RailtestEngine::isReplyStart(const char *line, int size) const
+{
+    int commandSize = _command.size();
+
+    return size >= commandSize + 5
+        && 0 == memcmp(line, "{{(", 3)
+        && 0 == qstrnicmp(line + 3, _command.constData(), commandSize)
+        && line[3 + commandSize] == ')'
+        && line[4 + commandSize] == '}';
+}
+
+void RailtestEngine::onLine(const char *line, int size)
+{
+    // Output which followed the prompt without a new line, e.g. the command echo.
+    if (size >= 2 && line[0] == '>' && line[1] == ' ')
+    {
+        onPrompt();
+        line += 2;
+        size -= 2;
+    }
+
+    if (_expecting)
+    {
+        if (!_replyStarted)
+            _replyStarted = isReplyStart(line, size);
+
+        if (_replyStarted)
+        {
+            _reply.append(line, size);
+            _reply.append("\r\n", 2);
+        }
+    }
+
+    if (_recordHandler && size >= 2 && line[0] == '{' && line[1] == '{')
+        _recordHandler(RailtestReply::parse(QByteArray(line, size)));
+}
+
+void RailtestEngine::onPrompt()
+{
+    if (_promptHandler)
+        _promptHandler();
+
+    if (!_expecting || !_replyStarted)
+        return;
+
+    // The handler may expect the next command already.
+    ReplyHandler handler;
+    QByteArray text;
+
+    handler.swap(_replyHandler);
+    text.swap(_reply);
+    text.chop(2);
+    _expecting = false;
+    _replyStarted = false;
+
+    if (handler)
+        handler(RailtestReply::parse(text));
+}
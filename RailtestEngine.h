@@ -0,0 +1,65 @@
+#ifndef RAILTESTENGINE_H
+#define RAILTESTENGINE_H
+
+#include <QByteArray>
+
+#include <functional>
+
+#include "RailtestReply.h"
+
+// Incremental decoder of the railtest console output, shared by the transports
+// (PortManager DUT channels, RailtestClient serial port).
+//
+// Received bytes are appended to a ring buffer and split into lines as they arrive,
+// each byte is scanned once. Subscribers get every record line, the command prompt and
+// the assembled reply of the awaited command.
+class RailtestEngine
+{
+public:
+
+    typedef std::function<void(const RailtestReply &record)> RecordHandler;   // Single line
+    typedef std::function<void()> PromptHandler;
+    typedef std::function<void(const RailtestReply &reply)> ReplyHandler;
+
+    static constexpr int RING_SIZE = 8192;                  // Power of two, longest line
+
+    RailtestEngine() {}
+
+    void setRecordHandler(const RecordHandler &handler) {_recordHandler = handler;}
+    void setPromptHandler(const PromptHandler &handler) {_promptHandler = handler;}
+
+    // Assembles the reply of the command: from its {{(command)}...} line up to the prompt.
+    // Lines before the {{(command)} line are not part of the reply, so the command must be named.
+    void expect(const QByteArray &command, const ReplyHandler &handler);
+
+    // Stops waiting and returns the part of the reply received so far.
+    RailtestReply cancel();
+
+    bool isExpecting() const {return _expecting;}
+
+    void feed(const char *data, int size);
+    void reset();
+
+private:
+
+    char _ring[RING_SIZE];
+    quint32 _head = 0;                      // Start of the current line
+    quint32 _scan = 0;                      // Next byte to scan
+    quint32 _tail = 0;                      // End of the received data
+    QByteArray _line;                       // Linear copy of a line wrapped around the ring end
+
+    RecordHandler _recordHandler;
+    PromptHandler _promptHandler;
+
+    bool _expecting = false;
+    bool _replyStarted = false;
+    QByteArray _command;
+    QByteArray _reply;
+    ReplyHandler _replyHandler;
+
+    void onLine(const char *line, int size);
+    void onPrompt();
+    bool isReplyStart(const char *line, int size) const;
+};
+
+#endif // RAILTESTENGINE_H
@@ -0,0 +1,238 @@
+#include "RailtestReply.h"
+
+#include <string.h>
+
+static inline bool _isTokenSeparator(char ch)
+{
+    switch (ch)
+    {
+        case ' ': case '\t': case '\n': case '\v': case '\f': case '\r':
+        case '{': case '}': case '>':
+            return true;
+        default:
+            return false;
+    }
+}
+
+RailtestReply RailtestReply::parse(const QByteArray &text, bool complete)
+{
+    RailtestReply reply;
+
+    reply._text = text;
+    reply._complete = complete;
+
+    const char *p = text.constData();
+    const int size = text.size();
+    int i = 0;
+
+    while (i < size)
+    {
+        if (p[i] != '{' || i + 1 >= size || p[i + 1] != '{')
+        {
+            ++i;
+            continue;
+        }
+
+        Record record = {0, 0, reply._items.size(), 0};
+        int pos = i + 1;
+        bool closed = false;
+
+        // Items: {content}, the record is closed by one more '}'
+        while (pos < size && p[pos] == '{')
+        {
+            int start = pos + 1;
+            int end = start;
+
+            while (end < size && p[end] != '}' && p[end] != '{' && p[end] != '\r' && p[end] != '\n')
+                ++end;
+
+            if (end >= size || p[end] != '}')
+                break;
+
+            int length = end - start;
+
+            if (pos == i + 1 && length >= 2 && p[start] == '(' && p[end - 1] == ')')
+            {
+                record.command = start + 1;
+                record.commandSize = length - 2;
+            }
+            else
+            {
+                const char *colon = (const char*)memchr(p + start, ':', length);
+
+                if (colon)
+                    reply._items.append({start, int(colon - p) - start, int(colon - p) + 1, end - int(colon - p) - 1});
+                else
+                    reply._items.append({start, -1, start, length});
+
+                ++record.itemCount;
+            }
+
+            pos = end + 1;
+
+            if (pos < size && p[pos] == '}')
+            {
+                closed = true;
+                ++pos;
+                break;
+            }
+        }
+
+        if (!closed)
+        {
+            // Not a reply line, drop the items collected for it.
+            reply._items.resize(record.firstItem);
+            ++i;
+            continue;
+        }
+
+        if (record.commandSize == 0)
+            reply._list = true;
+
+        reply._records.append(record);
+        i = pos;
+    }
+
+    return reply;
+}
+
+QByteArray RailtestReply::command() const
+{
+    for (auto & record : _records)
+        if (record.commandSize > 0)
+            return mid(record.command, record.commandSize);
+
+    return QByteArray();
+}
+
+int RailtestReply::findItem(const char *key) const
+{
+    int keySize = strlen(key);
+
+    for (int i = 0; i < _items.size(); ++i)
+    {
+        const Item &item = _items.at(i);
+
+        if (item.keySize == keySize && 0 == memcmp(_text.constData() + item.key, key, keySize))
+            return i;
+    }
+
+    return -1;
+}
+
+QByteArray RailtestReply::value(const char *key, const QByteArray &defaultValue) const
+{
+    int i = findItem(key);
+
+    return i < 0 ? defaultValue : mid(_items.at(i).value, _items.at(i).valueSize);
+}
+
+QList<QByteArray> RailtestReply::values() const
+{
+    QList<QByteArray> list;
+
+    for (auto & item : _items)
+        if (item.keySize < 0)
+            list.append(mid(item.value, item.valueSize));
+
+    return list;
+}
+
+QStringList RailtestReply::tokens() const
+{
+    QStringList list;
+    const char *p = _text.constData();
+    const int size = _text.size();
+    int i = 0;
+
+    while (i < size)
+    {
+        while (i < size && _isTokenSeparator(p[i]))
+            ++i;
+
+        int start = i;
+
+        while (i < size && !_isTokenSeparator(p[i]))
+            ++i;
+
+        if (i > start)
+            list.append(QString::fromUtf8(p + start, i - start));
+    }
+
+    return list;
+}
+
+QVariant RailtestReply::typedValue(const Item &item) const
+{
+    QByteArray value = mid(item.value, item.valueSize);
+    bool ok;
+
+    int intValue = value.toInt(&ok);
+    if (ok)
+        return intValue;
+
+    qlonglong longValue = value.toLongLong(&ok);
+    if (ok)
+        return longValue;
+
+    double doubleValue = value.toDouble(&ok);
+    if (ok)
+        return doubleValue;
+
+    return QString::fromUtf8(value);
+}
+
+QVariantMap RailtestReply::toVariantMap() const
+{
+    QVariantMap map;
+    QVariantMap fields;
+    QVariantList values;
+    QVariantList records;
+
+    for (auto & record : _records)
+    {
+        QVariantMap recordFields;
+        QVariantList recordValues;
+
+        for (int i = record.firstItem; i < record.firstItem + record.itemCount; ++i)
+        {
+            const Item &item = _items.at(i);
+
+            if (item.keySize < 0)
+            {
+                recordValues.append(typedValue(item));
+                continue;
+            }
+
+            QString key = QString::fromUtf8(mid(item.key, item.keySize));
+            QVariant value = typedValue(item);
+
+            if (!recordFields.contains(key))
+                recordFields.insert(key, value);
+
+            if (!fields.contains(key))
+                fields.insert(key, value);
+        }
+
+        values += recordValues;
+
+        QVariantMap recordMap;
+
+        recordMap.insert("command", QString::fromUtf8(mid(record.command, record.commandSize)));
+        recordMap.insert("fields", recordFields);
+        recordMap.insert("values", recordValues);
+        records.append(recordMap);
+    }
+
+    map.insert("valid", isValid());
+    map.insert("command", QString::fromUtf8(command()));
+    map.insert("complete", _complete);
+    map.insert("multiLine", isMultiLine());
+    map.insert("list", _list);
+    map.insert("fields", fields);
+    map.insert("values", values);
+    map.insert("records", records);
+    map.insert("text", QString::fromUtf8(_text).simplified());
+
+    return map;
+}
@@ -0,0 +1,74 @@
+#ifndef RAILTESTREPLY_H
+#define RAILTESTREPLY_H
+
+#include <QByteArray>
+#include <QStringList>
+#include <QVariantMap>
+#include <QVector>
+
+// Parsed railtest reply.
+// Grammar of a reply line: {{(cmd)}{key:value}{value}...}, list lines have no (cmd) item.
+// The parser scans the text once and keeps offsets into it, so a reply costs a few allocations
+// regardless of the number of items.
+class RailtestReply
+{
+public:
+
+    struct Item
+    {
+        int key, keySize;                           // keySize is -1 for the items without a key
+        int value, valueSize;
+    };
+
+    struct Record
+    {
+        int command, commandSize;                   // commandSize is 0 for list lines
+        int firstItem, itemCount;
+    };
+
+    RailtestReply() {}
+
+    // Parses reply text without the trailing prompt. Incomplete replies are cut by the timeout.
+    static RailtestReply parse(const QByteArray &text, bool complete = true);
+
+    bool isValid() const {return !_text.isEmpty();}
+    bool isComplete() const {return _complete;}
+    bool isMultiLine() const {return _records.size() > 1;}
+    bool isList() const {return _list;}
+
+    // Name of the first command record.
+    QByteArray command() const;
+
+    // Value of the first item with the key.
+    QByteArray value(const char *key, const QByteArray &defaultValue = QByteArray()) const;
+    bool contains(const char *key) const {return findItem(key) >= 0;}
+
+    // Items without a key, over all records.
+    QList<QByteArray> values() const;
+
+    const QVector<Record> &records() const {return _records;}
+    const QVector<Item> &items() const {return _items;}
+    const QByteArray &text() const {return _text;}
+
+    // Compatibility view: the reply text split on whitespace, braces and '>',
+    // as returned by PortManager::railtestCommand().
+    QStringList tokens() const;
+
+    // Object for the scripts: {valid, command, complete, multiLine, list, fields: {key: value}, values: [...],
+    // records: [{command, fields, values}], text}. Decimal numbers are converted to numbers.
+    QVariantMap toVariantMap() const;
+
+private:
+
+    QByteArray _text;
+    QVector<Record> _records;
+    QVector<Item> _items;
+    bool _complete = false;
+    bool _list = false;
+
+    int findItem(const char *key) const;
+    QByteArray mid(int pos, int size) const {return QByteArray(_text.constData() + pos, size);}
+    QVariant typedValue(const Item &item) const;
+};
+
+#endif // RAILTESTREPLY_H
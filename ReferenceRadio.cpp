@@ -0,0 +1,232 @@
+#include "ReferenceRadio.h"
+
+#include <QCoreApplication>
+
+#include "PortRegistry.h"
+
+ReferenceModule::ReferenceModule(QObject *parent)
+    : QObject(parent),
+      _client(this)
+{
+    connect(&_client, &RailtestClient::replyReceived, this, &ReferenceModule::onReplyReceived);
+    _clock.start();
+}
+
+QString ReferenceModule::setUp(const QString &portName, int channel)
+{
+    QString error;
+
+    Q_ASSERT(QThread::currentThread() != thread());
+    QMetaObject::invokeMethod(this, "doSetUp", Qt::BlockingQueuedConnection,
+                              Q_RETURN_ARG(QString, error), Q_ARG(QString, portName), Q_ARG(int, channel));
+
+    return error;
+}
+
+bool ReferenceModule::receive(bool on)
+{
+    bool ok = false;
+
+    Q_ASSERT(QThread::currentThread() != thread());
+    QMetaObject::invokeMethod(this, "doReceive", Qt::BlockingQueuedConnection, Q_RETURN_ARG(bool, ok), Q_ARG(bool, on));
+
+    return ok;
+}
+
+bool ReferenceModule::waitPackets(int count, int timeout, int idleTimeout)
+{
+    QMutexLocker locker(&_packetMutex);
+    qint64 start = _clock.elapsed();
+
+    while (_rssi.count() < count)
+    {
+        qint64 now = _clock.elapsed();
+        qint64 rest = start + timeout - now;
+
+        if (idleTimeout >= 0)
+            rest = qMin(rest, qMax(start, _lastPacket) + idleTimeout - now);
+
+        if (rest <= 0)
+            return false;
+
+        _packetReceived.wait(&_packetMutex, (unsigned long)rest);
+    }
+
+    return true;
+}
+
+SampleStats ReferenceModule::rssi() const
+{
+    QMutexLocker locker(&_packetMutex);
+
+    return _rssi;
+}
+
+QString ReferenceModule::doSetUp(const QString &portName, int channel)
+{
+    QString error;
+
+    if (!_ready || portName != _portName)
+    {
+        _portName = portName;
+        if (!reset(&error))
+            return error;
+    }
+
+    if (channel != _channel)
+    {
+        if (!command("setChannel", QByteArray::number(channel)))
+        {
+            _ready = false;
+
+            return "Reference radio module does not respond.";
+        }
+
+        _channel = channel;
+    }
+
+    return QString();
+}
+
+bool ReferenceModule::doReceive(bool on)
+{
+    if (on)
+    {
+        QMutexLocker locker(&_packetMutex);
+
+        _rssi = SampleStats();
+        _lastPacket = _clock.elapsed();
+    }
+
+    return command("rx", on ? "1" : "0");
+}
+
+void ReferenceModule::onReplyReceived(const QString &id, const QVariantMap &params)
+{
+    bool ok;
+    int rssi = params.value("rssi").toInt(&ok);
+
+    if (id != "rxPacket" || !ok)
+        return;
+
+    QMutexLocker locker(&_packetMutex);
+
+    _rssi.add(rssi);
+    _lastPacket = _clock.elapsed();
+    _packetReceived.wakeAll();
+}
+
+bool ReferenceModule::reset(QString *error)
+{
+    _ready = false;
+    _channel = -1;
+
+    if (!_client.open(_portName))
+    {
+        *error = "Cannot open serial port for reference radio module.";
+
+        return false;
+    }
+
+    _client.syncCommand("reset", "", 2000);
+    if (!_client.waitCommandPrompt())
+    {
+        *error = "Timeout waiting reference radio module command prompt.";
+
+        return false;
+    }
+
+    _ready = command("rx", "0")
+             && command("setBleMode", "1")
+             && command("setBle1Mbps", "1");
+
+    if (!_ready)
+        *error = "Reference radio module does not respond.";
+
+    return _ready;
+}
+
+bool ReferenceModule::command(const QByteArray &cmd, const QByteArray &args)
+{
+    QVariantList replies = _client.syncCommand(cmd, args, 500);
+
+    return replies.isEmpty() || !replies.last().toMap().contains("error");
+}
+
+ReferenceRadio *ReferenceRadio::instance()
+{
+    static ReferenceRadio *radio = new ReferenceRadio(QCoreApplication::instance());
+
+    return radio;
+}
+
+ReferenceRadio::ReferenceRadio(QObject *parent) : QObject(parent)
+{
+}
+
+ReferenceRadio::~ReferenceRadio()
+{
+    for (auto module : _modules)
+    {
+        module->thread.quit();
+        module->thread.wait();
+    }
+
+    qDeleteAll(_modules);
+}
+
+ReferenceRadio::Module *ReferenceRadio::module(const QString &moduleId)
+{
+    QMutexLocker locker(&_mutex);
+    Module *&module = _modules[moduleId];
+
+    if (!module)
+    {
+        module = new Module;
+        module->radio = new ReferenceModule;
+        module->radio->moveToThread(&module->thread);
+        connect(&module->thread, &QThread::finished, module->radio, &QObject::deleteLater);
+        module->thread.setObjectName("Reference radio " + moduleId);
+        module->thread.start();
+    }
+
+    return module;
+}
+
+ReferenceModule *ReferenceRadio::acquire(const QString &moduleId, int channel, QString *error)
+{
+    Module *module = this->module(moduleId);
+
+    module->mutex.lock();
+
+    QString portName = PortRegistry::instance()->portName(moduleId);
+
+    if (portName.isEmpty())
+    {
+        *error = "Reference radio module is not attached.";
+        module->radio->invalidate();
+        module->mutex.unlock();
+
+        return nullptr;
+    }
+
+    *error = module->radio->setUp(portName, channel);
+    if (!error->isEmpty())
+    {
+        module->mutex.unlock();
+
+        return nullptr;
+    }
+
+    return module->radio;
+}
+
+void ReferenceRadio::release(const QString &moduleId, bool failed)
+{
+    Module *module = this->module(moduleId);
+
+    if (failed)
+        module->radio->invalidate();
+
+    module->mutex.unlock();
+}
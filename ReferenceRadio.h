@@ -0,0 +1,100 @@
+#ifndef REFERENCERADIO_H
+#define REFERENCERADIO_H
+
+#include <QObject>
+#include <QHash>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QElapsedTimer>
+#include <QThread>
+
+#include <atomic>
+
+#include "RailtestClient.h"
+#include "SampleStats.h"
+
+// Reference radio module living in its own thread. The RailtestClient and its serial port
+// are used in that thread only: the testers call the blocking wrappers below from their
+// threads and wait for the packets on a condition, never on the port.
+class ReferenceModule : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit ReferenceModule(QObject *parent = nullptr);
+
+    // Sets the module up for BLE 1 Mbps on the channel, receiver off. Resets it on the first
+    // use, after invalidate() or when the port changes. Returns the error text, empty if ready.
+    QString setUp(const QString &portName, int channel);
+
+    // Receiver on or off, false if the module does not respond. Switching on clears the packets.
+    bool receive(bool on);
+
+    // Waits until count packets have been received since receive(true), no packet comes for
+    // idleTimeout ms (-1 - no limit) or the timeout expires.
+    bool waitPackets(int count, int timeout, int idleTimeout = -1);
+    SampleStats rssi() const;
+
+    // The next setUp() resets the module. Any thread.
+    void invalidate() {_ready = false;}
+
+private slots:
+
+    QString doSetUp(const QString &portName, int channel);
+    bool doReceive(bool on);
+    void onReplyReceived(const QString &id, const QVariantMap &params);
+
+private:
+
+    RailtestClient _client;
+    QString _portName;
+    int _channel = -1;
+    std::atomic<bool> _ready {false};
+
+    mutable QMutex _packetMutex;                // Guards the packet figures below
+    QWaitCondition _packetReceived;
+    SampleStats _rssi;
+    qint64 _lastPacket = 0;                     // _clock msecs
+    QElapsedTimer _clock;
+
+    bool reset(QString *error);
+    bool command(const QByteArray &cmd, const QByteArray &args);
+};
+
+// Station-wide owner of the reference radio modules, indexed by the USB serial number.
+// Every module stays open in its thread for the session and is reconfigured only when the
+// channel changes.
+class ReferenceRadio : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    static ReferenceRadio *instance();
+
+    // Exclusive use of the module set up on the channel. Returns null with the reason in *error.
+    // Every successful acquire() needs a release() from the same thread; failed = true makes the
+    // next acquire() reset the module. Not to be called from the module threads.
+    ReferenceModule *acquire(const QString &moduleId, int channel, QString *error);
+    void release(const QString &moduleId, bool failed = false);
+
+private:
+
+    struct Module
+    {
+        QMutex mutex;
+        QThread thread;
+        ReferenceModule *radio = nullptr;       // Deleted in its thread when the thread finishes
+    };
+
+    explicit ReferenceRadio(QObject *parent = nullptr);
+    ~ReferenceRadio();
+
+    Module *module(const QString &moduleId);
+
+    QMutex _mutex;                              // Guards the module table only
+    QHash<QString, Module*> _modules;
+};
+
+#endif // REFERENCERADIO_H
@@ -0,0 +1,127 @@
+#include "SampleStats.h"
+
+#include <algorithm>
+
+#include <cmath>
+
+// Desired marker position increments for the median: 0, p/2, p, (1+p)/2, 1.
+static const double _increments[] = {0.0, 0.25, 0.5, 0.75, 1.0};
+
+void SampleStats::clear()
+{
+    _count = 0;
+    _min = 0.0;
+    _max = 0.0;
+    _mean = 0.0;
+    _m2 = 0.0;
+}
+
+double SampleStats::stddev() const
+{
+    return std::sqrt(variance());
+}
+
+void SampleStats::add(double value)
+{
+    ++_count;
+
+    if (_count <= EXACT_SAMPLES)
+        _samples[_count - 1] = value;
+
+    if (_count == 1)
+    {
+        _min = value;
+        _max = value;
+    }
+    else
+    {
+        _min = qMin(_min, value);
+        _max = qMax(_max, value);
+    }
+
+    double delta = value - _mean;
+
+    _mean += delta / _count;
+    _m2 += delta * (value - _mean);
+
+    if (_count <= MARKERS)
+    {
+        _heights[_count - 1] = value;
+        if (_count == MARKERS)
+        {
+            std::sort(_heights, _heights + MARKERS);
+            for (int i = 0; i < MARKERS; ++i)
+            {
+                _positions[i] = i + 1;
+                _desired[i] = 1.0 + 4.0 * _increments[i];
+            }
+        }
+
+        return;
+    }
+
+    // Cell of the new value, the extreme markers follow min and max.
+    int cell;
+
+    if (value < _heights[0])
+    {
+        _heights[0] = value;
+        cell = 0;
+    }
+    else if (value >= _heights[MARKERS - 1])
+    {
+        _heights[MARKERS - 1] = value;
+        cell = MARKERS - 2;
+    }
+    else
+    {
+        cell = 0;
+        while (value >= _heights[cell + 1])
+            ++cell;
+    }
+
+    for (int i = cell + 1; i < MARKERS; ++i)
+        ++_positions[i];
+    for (int i = 0; i < MARKERS; ++i)
+        _desired[i] += _increments[i];
+
+    // Moves the middle markers towards their desired positions, parabolic if it keeps the order.
+    for (int i = 1; i < MARKERS - 1; ++i)
+    {
+        double offset = _desired[i] - _positions[i];
+
+        if ((offset >= 1.0 && _positions[i + 1] - _positions[i] > 1) ||
+            (offset <= -1.0 && _positions[i - 1] - _positions[i] < -1))
+        {
+            int step = offset > 0 ? 1 : -1;
+            double n = _positions[i];
+            double nNext = _positions[i + 1];
+            double nPrev = _positions[i - 1];
+            double height = _heights[i] + step / (nNext - nPrev) *
+                            ((n - nPrev + step) * (_heights[i + 1] - _heights[i]) / (nNext - n) +
+                             (nNext - n - step) * (_heights[i] - _heights[i - 1]) / (n - nPrev));
+
+            if (height <= _heights[i - 1] || height >= _heights[i + 1])
+                height = _heights[i] + step * (_heights[i + step] - _heights[i]) / (_positions[i + step] - n);
+
+            _heights[i] = height;
+            _positions[i] += step;
+        }
+    }
+}
+
+double SampleStats::median() const
+{
+    if (_count > EXACT_SAMPLES)
+        return _heights[2];
+
+    if (_count == 0)
+        return 0.0;
+
+    double sorted[EXACT_SAMPLES];
+
+    std::copy(_samples, _samples + _count, sorted);
+    std::sort(sorted, sorted + _count);
+
+    return (_count % 2) ? sorted[_count / 2] : (sorted[_count / 2 - 1] + sorted[_count / 2]) / 2.0;
+}
@@ -0,0 +1,44 @@
+#ifndef SAMPLESTATS_H
+#define SAMPLESTATS_H
+
+#include <QtGlobal>
+
+// Streaming statistics of a measurement burst: min/max, Welford mean and variance and
+// the median. The median is exact up to EXACT_SAMPLES samples, kept in a fixed array,
+// and the P-square estimate beyond. Fixed size, no sample vector.
+class SampleStats
+{
+public:
+
+    SampleStats() {clear();}
+
+    void add(double value);
+    void clear();
+
+    int count() const {return _count;}
+    double min() const {return _min;}
+    double max() const {return _max;}
+    double mean() const {return _mean;}
+    double variance() const {return _count > 1 ? _m2 / (_count - 1) : 0.0;}
+    double stddev() const;
+    double median() const;
+
+private:
+
+    static constexpr int EXACT_SAMPLES = 32;    // Covers the pass/fail bursts of the scripts
+    static constexpr int MARKERS = 5;
+
+    int _count;
+    double _min;
+    double _max;
+    double _mean;
+    double _m2;
+    double _samples[EXACT_SAMPLES];
+
+    // P-square markers: heights, actual and desired positions.
+    double _heights[MARKERS];
+    int _positions[MARKERS];
+    double _desired[MARKERS];
+};
+
+#endif // SAMPLESTATS_H
@@ -0,0 +1,230 @@
+#include "SlipCodec.h"
+#include "Crc16.h"
+
+#include <QDebug>
+
+#include <string.h>
+
+static constexpr char
+    END_SLIP_OCTET = -64, // 0xC0
+    END_SUBS_OCTET = -36, // 0xDC
+    ESC_SLIP_OCTET = -37, // 0xDB
+    ESC_SUBS_OCTET = -35; // 0xDD
+
+static constexpr int MIN_FRAME_SIZE = sizeof(quint8) + sizeof(quint16) + 1;
+
+static inline char *_encodeSymbol(char *buffer, char ch) Q_DECL_NOTHROW
+{
+    switch (ch)
+    {
+        case END_SLIP_OCTET:
+            *buffer++ = ESC_SLIP_OCTET;
+            *buffer++ = END_SUBS_OCTET;
+            break;
+
+        case ESC_SLIP_OCTET:
+            *buffer++ = ESC_SLIP_OCTET;
+            *buffer++ = ESC_SUBS_OCTET;
+            break;
+
+        default:
+            *buffer++ = ch;
+    }
+
+    return buffer;
+}
+
+constexpr int SlipCodec::RX_BUFFER_SIZE;
+
+SlipCodec::SlipCodec(const FrameHandler &handler) : _handler(handler)
+{
+}
+
+int SlipCodec::encode(int channel, const char *data, int size)
+{
+    // Every symbol may be escaped: channel, data and CRC plus two END octets.
+    int maxSize = (size + 3) * 2 + 2;
+
+    if (_txBuffer.size() < maxSize)
+        _txBuffer.resize(maxSize);
+
+    char *begin = _txBuffer.data(), *out = begin;
+    quint16 frameCrc = Crc16::ccitt(data, size, Crc16::update(0xFFFF, channel));
+
+    // Write SLIP frame start.
+    *out++ = END_SLIP_OCTET;
+
+    // Write escaped channel number.
+    out = _encodeSymbol(out, channel);
+
+    // Write escaped frame.
+    for (int i = 0; i < size; ++i)
+        out = _encodeSymbol(out, data[i]);
+
+    // Write escaped CRC.
+    out = _encodeSymbol(out, frameCrc >> 8);
+    out = _encodeSymbol(out, frameCrc & 0xFF);
+
+    // Write SLIP frame end.
+    *out++ = END_SLIP_OCTET;
+
+    return out - begin;
+}
+
+char *SlipCodec::receiveBuffer(int *size)
+{
+    // Move the unfinished frame to the buffer start, so the frame always stays contiguous.
+    if (_frameStart > 0)
+    {
+        memmove(_rxBuffer, _rxBuffer + _frameStart, _end - _frameStart);
+        _decoded -= _frameStart;
+        _end -= _frameStart;
+        _frameStart = 0;
+    }
+
+    if (_end == RX_BUFFER_SIZE)
+    {
+        qWarning() << "SLIP. Decode frame. Frame too long.";
+        ++_stats.longFrames;
+        _state = SkipFrame;
+        _decoded = _end = 0;
+    }
+
+    *size = RX_BUFFER_SIZE - _end;
+
+    return _rxBuffer + _end;
+}
+
+void SlipCodec::commit(int size)
+{
+    int scan = _end;
+
+    _end += size;
+    while (scan < _end)
+    {
+        char ch = _rxBuffer[scan++];
+
+        if (ch == END_SLIP_OCTET)
+        {
+            switch (_state)
+            {
+                case ReadEscape:
+                    qWarning() << "SLIP. Decode frame. Unfinished escape sequence.";
+                    ++_stats.escapeErrors;
+                    break;
+
+                case ReadFrame:
+                    finishFrame();
+                    break;
+
+                default:
+                    break;
+            }
+
+            // Every END octet may also start the next frame.
+            _state = ReadFrame;
+            _frameStart = _decoded = scan;
+            _crc = 0xFFFF;
+            continue;
+        }
+
+        switch (_state)
+        {
+            case ReadFrame:
+                if (ch == ESC_SLIP_OCTET)
+                    _state = ReadEscape;
+                else
+                    putByte(ch);
+                break;
+
+            case ReadEscape:
+                switch (ch)
+                {
+                    case END_SUBS_OCTET:
+                        putByte(END_SLIP_OCTET);
+                        _state = ReadFrame;
+                        break;
+
+                    case ESC_SUBS_OCTET:
+                        putByte(ESC_SLIP_OCTET);
+                        _state = ReadFrame;
+                        break;
+
+                    default:
+                        qWarning() << "SLIP. Decode frame. Invalid escape sequence.";
+                        ++_stats.escapeErrors;
+                        _state = SkipFrame;
+                }
+                break;
+
+            default:
+                // Wait for frame start or skip the rest of broken frame.
+                break;
+        }
+    }
+
+    // All raw bytes are scanned, keep only the unescaped part of the current frame.
+    if (_state == ReadFrame || _state == ReadEscape)
+        _end = _decoded;
+    else
+        _frameStart = _decoded = _end = 0;
+}
+
+void SlipCodec::feed(const char *data, int size)
+{
+    while (size > 0)
+    {
+        int freeSize;
+        char *buffer = receiveBuffer(&freeSize);
+        int chunkSize = qMin(size, freeSize);
+
+        memcpy(buffer, data, chunkSize);
+        commit(chunkSize);
+        data += chunkSize;
+        size -= chunkSize;
+    }
+}
+
+void SlipCodec::reset()
+{
+    _state = WaitFrameStart;
+    _frameStart = _decoded = _end = 0;
+}
+
+inline void SlipCodec::putByte(char ch)
+{
+    // Unescaped data never outruns the scan position.
+    _rxBuffer[_decoded++] = ch;
+    _crc = Crc16::update(_crc, ch);
+}
+
+void SlipCodec::finishFrame()
+{
+    int frameSize = _decoded - _frameStart;
+
+    // Empty frames are produced by back-to-back END octets.
+    if (0 == frameSize)
+        return;
+
+    if (frameSize < MIN_FRAME_SIZE)
+    {
+        qWarning() << "SLIP. Decode frame. Frame too short.";
+        ++_stats.shortFrames;
+
+        return;
+    }
+
+    // CRC over the frame including its big endian CRC field is zero for CRC-CCITT.
+    if (_crc != 0)
+    {
+        qWarning() << "SLIP. Decode frame. Invalid Frame CRC.";
+        ++_stats.crcErrors;
+
+        return;
+    }
+
+    // Frame received successfully.
+    ++_stats.frames;
+    if (_handler)
+        _handler((quint8)_rxBuffer[_frameStart], _rxBuffer + _frameStart + 1, frameSize - 3);
+}
@@ -0,0 +1,78 @@
+#ifndef SLIPCODEC_H
+#define SLIPCODEC_H
+
+#include <QByteArray>
+
+#include <functional>
+
+// Incremental SLIP codec for the measuring board link.
+// Frame layout: END, channel, payload..., CRC16 (big endian), END.
+//
+// Received bytes are written straight into the preallocated receive buffer,
+// unescaped in place and checked by CRC while scanning, so decoding needs no
+// heap allocations. Decoded payloads are handed out as views into that buffer.
+class SlipCodec
+{
+public:
+
+    // Non-owning view of the decoded payload, valid only inside the frame handler.
+    // The handler must not feed the codec again (i.e. run blocking commands).
+    typedef std::function<void(int channel, const char *data, int size)> FrameHandler;
+
+    static constexpr int RX_BUFFER_SIZE = 8192;
+
+    // Receive error counters, kept across reset().
+    struct Stats
+    {
+        quint64 frames = 0;
+        quint64 crcErrors = 0;
+        quint64 escapeErrors = 0;
+        quint64 shortFrames = 0;
+        quint64 longFrames = 0;
+    };
+
+    explicit SlipCodec(const FrameHandler &handler = FrameHandler());
+
+    void setFrameHandler(const FrameHandler &handler) {_handler = handler;}
+
+    // Encodes single frame for the channel (0 - board, 1..3 - DUT UARTs) into
+    // the reusable transmit buffer and returns the encoded size.
+    // The encoded data stays valid until the next encode() call.
+    int encode(int channel, const char *data, int size);
+    const char *encodedData() const {return _txBuffer.constData();}
+
+    // Free space of the receive buffer. Bytes written there are decoded by commit().
+    char *receiveBuffer(int *size);
+    void commit(int size);
+
+    // Copies received bytes into the receive buffer and decodes them.
+    void feed(const char *data, int size);
+
+    void reset();
+
+    const Stats &stats() const {return _stats;}
+    void resetStats() {_stats = Stats();}
+
+private:
+
+    enum State {WaitFrameStart, ReadFrame, ReadEscape, SkipFrame};
+
+    inline void putByte(char ch);
+    void finishFrame();
+
+    FrameHandler _handler;
+    State _state = WaitFrameStart;
+    quint16 _crc = 0xFFFF;
+
+    // Receive buffer layout: [_frameStart, _decoded) - unescaped part of the
+    // current frame, [_decoded, _end) - raw bytes not scanned yet.
+    char _rxBuffer[RX_BUFFER_SIZE];
+    int _frameStart = 0;
+    int _decoded = 0;
+    int _end = 0;
+
+    QByteArray _txBuffer;
+    Stats _stats;
+};
+
+#endif // SLIPCODEC_H
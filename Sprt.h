@@ -0,0 +1,50 @@
+#ifndef SPRT_H
+#define SPRT_H
+
+#include <QtGlobal>
+
+#include <cmath>
+
+// Wald's sequential probability ratio test between a good and a bad hypothesis.
+// The log likelihood ratios below grow with the evidence for the bad one; the test
+// stops once the ratio leaves the band set by the error rates.
+class Sprt
+{
+public:
+
+    enum Decision {Continue, Pass, Fail};
+
+    // alpha - rate of failing a good unit, beta - rate of passing a bad one.
+    explicit Sprt(double alpha = 0.01, double beta = 0.01)
+        : _passBound(std::log(beta / (1.0 - alpha))),
+          _failBound(std::log((1.0 - beta) / alpha))
+    {
+    }
+
+    Decision decide(double llr) const
+    {
+        if (llr >= _failBound)
+            return Fail;
+
+        return (llr <= _passBound) ? Pass : Continue;
+    }
+
+    // Bernoulli trials, e.g. packets received out of sent, with the success rates of the hypotheses.
+    static double bernoulliLlr(int successes, int trials, double good, double bad)
+    {
+        return successes * std::log(bad / good) + (trials - successes) * std::log((1.0 - bad) / (1.0 - good));
+    }
+
+    // Normal samples with the known sigma and the means of the hypotheses.
+    static double gaussianLlr(int count, double mean, double sigma, double good, double bad)
+    {
+        return count * (good - bad) * (good + bad - 2.0 * mean) / (2.0 * sigma * sigma);
+    }
+
+private:
+
+    double _passBound;
+    double _failBound;
+};
+
+#endif // SPRT_H
@@ -0,0 +1,23 @@
+#include "Station.h"
+
+#include <QEventLoop>
+#include <QTimer>
+
+Station::Station(QObject *parent) : QObject(parent)
+{
+}
+
+void Station::wait(int msecs)
+{
+    if (msecs <= 0)
+        return;
+
+    QEventLoop loop;
+    QTimer timer;
+
+    timer.setSingleShot(true);
+    timer.setTimerType(Qt::PreciseTimer);
+    connect(&timer, &QTimer::timeout, &loop, &QEventLoop::quit);
+    timer.start(msecs);
+    loop.exec();
+}
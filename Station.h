@@ -0,0 +1,25 @@
+#ifndef STATION_H
+#define STATION_H
+
+#include <QObject>
+
+// Station services for the scripts, available as the "station" global.
+class Station : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit Station(QObject *parent = nullptr);
+
+    // Sleeps in a local event loop woken by a timer, so the GUI, the serial ports and the
+    // other timers of the thread keep working without spinning the CPU. Nested waits are safe:
+    // an outer wait ends when its time is up and the inner ones have returned.
+    static void wait(int msecs);
+
+public slots:
+
+    void sleep(int msecs) {wait(msecs);}
+};
+
+#endif // STATION_H
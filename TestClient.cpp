@@ -1,30 +1,70 @@
 #include "TestClient.h"
 
-#include <QCoreApplication>
-#include <QtEndian>
-#include <QSerialPortInfo>
-#include <math.h>
-
-static const int NO_RESPONSE = -100;
+#include <QDir>
+#include <QDateTime>
+#include <algorithm>
+#include <functional>
 
 TestClient::TestClient(const QSharedPointer<QSettings> &settings, int no, QObject *parent)
     : QObject(parent),
       _portManager(this),
       _no(no),
-      _settings(settings)
+      _settings(settings),
+      _dutTimer(this),
+      _powerTimer(this)
 {
 //    connect(&_portManager, &PortManager::responseRecieved, this, &TestClient::responseRecieved);
 
-    connect(this, &TestClient::slotFullyTested, [this](int slot){emit dutFullyTested(_duts[slot]);});
-
-    _duts[1] = dutTemplate;
-    _duts[2] = dutTemplate;
-    _duts[3] = dutTemplate;
+    _portManager.setWindowSize(_settings->value("TestBoard/commandWindow", 4).toInt());
+    _portManager.setTimeoutPolicy(_settings->value("Timeouts/percentile", 99.9).toDouble(),
+                                  _settings->value("Timeouts/margin", 3.0).toDouble(),
+                                  _settings->value("Timeouts/min", 50).toInt(),
+                                  _settings->value("Timeouts/default", 5000).toInt(),
+                                  _settings->value("Timeouts/minSamples", 30).toInt());
+    loadLatency();
+
+    connect(this, &TestClient::slotFullyTested, [this](int slot){emit dutFullyTested(_duts[slotIndex(slot)]);});
+    connect(&_portManager, &PortManager::boardStarted, this, &TestClient::onBoardStarted);
+    connect(&_portManager, &PortManager::boardEvent, this, &TestClient::onBoardEvent);
+    connect(PortRegistry::instance(), &PortRegistry::portAttached, this, &TestClient::onPortAttached);
+    connect(PortRegistry::instance(), &PortRegistry::portDetached, this, &TestClient::onPortDetached);
+    connect(&_powerTimer, &QTimer::timeout, this, &TestClient::onPowerSample);
+
+    _dutTimer.setSingleShot(true);
+    _dutTimer.setTimerType(Qt::PreciseTimer);
+    _dutTimer.setInterval(_settings->value("GUI/dutRefreshInterval", 16).toInt());
+    connect(&_dutTimer, &QTimer::timeout, this, &TestClient::flushDutChanges);
+
+    _powerClock.start();
+    _powerSteps.append(QString());
 }
 
 TestClient::~TestClient()
 {
+    saveLatency();
+}
+
+void TestClient::loadLatency()
+{
+    _settings->beginGroup(QString("Latency%1").arg(_no));
+    for (auto & key : _settings->childKeys())
+    {
+        LatencyHistogram histogram;
+
+        histogram.fromString(_settings->value(key).toString());
+        _portManager.setLatencyHistogram(key.toLatin1(), histogram);
+    }
+    _settings->endGroup();
+}
+
+void TestClient::saveLatency()
+{
+    const QHash<QByteArray, LatencyHistogram> &histograms = _portManager.latencyHistograms();
 
+    _settings->beginGroup(QString("Latency%1").arg(_no));
+    for (auto it = histograms.constBegin(); it != histograms.constEnd(); ++it)
+        _settings->setValue(QString::fromLatin1(it.key()), it->toString());
+    _settings->endGroup();
 }
 
 void TestClient::setLogger(const QSharedPointer<Logger> &logger)
@@ -39,69 +79,234 @@ void TestClient::setPort(const QString &portName)
 
 void TestClient::open()
 {
-    if(_portManager.open() && readCSA(0) != NO_RESPONSE)
+    if(openPort() && readCSA(0) != NO_RESPONSE)
         _isConnected = true;
     else
         qDebug() << "MeasBoard" << _no << "is not connected";
 }
 
+bool TestClient::openPort()
+{
+    // Every connection of the board gets its own trace when the capture is configured.
+    QString captureDir = _settings->value("Debug/captureDir").toString();
+
+    if (!captureDir.isEmpty() && QDir().mkpath(captureDir))
+        startCapture(QDir(captureDir).filePath(QString("MB%1_%2.mblt").arg(_no).arg(QDateTime::currentDateTime().toString("yyyyMMdd_hhmmss"))));
+
+    return _portManager.open();
+}
+
+void TestClient::startPowerSampling(int msecs, bool rails, int peakLimit)
+{
+    // The timer belongs to the board thread.
+    QMetaObject::invokeMethod(this, "runPowerSampler", Qt::QueuedConnection, Q_ARG(int, msecs), Q_ARG(bool, rails), Q_ARG(int, peakLimit));
+}
+
+void TestClient::runPowerSampler(int msecs, bool rails, int peakLimit)
+{
+    _powerRails = rails;
+    _powerPeakLimit = peakLimit;
+
+    if (msecs > 0)
+    {
+        _powerSampler.setMaxGap(qint64(msecs) * 3000);
+        _powerTimer.start(msecs);
+    }
+    else
+        _powerTimer.stop();
+}
+
+void TestClient::onPowerSample()
+{
+    PowerSampler::Sample sample;
+
+    sample.slot = quint8(slotIndex(_currentSlot));
+    sample.step = quint16(_powerStep.load());
+    sample.rail = PowerSampler::Current;
+
+    if (!tryBoardCommand<MB_ReadCsa>(&sample.value, 0))
+        return;
+
+    sample.usecs = _powerClock.nsecsElapsed() / 1000;
+    _powerSampler.push(sample);
+
+    if (_powerPeakLimit > 0 && sample.value > _powerPeakLimit)
+    {
+        quint32 bit = 1u << sample.slot;
+
+        if (!(_powerFaults.fetch_or(bit) & bit))
+        {
+            _logger->logError(QString("Measuring Board %1: supply current %2 mA exceeds the limit, slot %3").arg(_no).arg(sample.value).arg(sample.slot));
+            emit powerFault(sample.slot, sample.value);
+        }
+    }
+
+    if (!_powerRails)
+        return;
+
+    sample.rail = PowerSampler::Rail24V;
+    if (tryBoardCommand<MB_Read24V>(&sample.value))
+        _powerSampler.push(sample);
+
+    sample.rail = PowerSampler::Rail3V;
+    if (tryBoardCommand<MB_Read3V>(&sample.value))
+        _powerSampler.push(sample);
+}
+
+void TestClient::setPowerStep(const QString &step)
+{
+    int index = _powerSteps.indexOf(step);
+
+    if (index < 0)
+    {
+        _powerSteps.append(step);
+        index = _powerSteps.size() - 1;
+    }
+
+    _powerStep = index;
+}
+
+QVariantMap TestClient::powerProfile(int slot)
+{
+    _powerSampler.drain();
+
+    const PowerSampler::Profile &profile = _powerSampler.profile(slotIndex(slot));
+    QVariantMap result;
+
+    result["samples"] = profile.samples;
+    result["charge"] = profile.charge;
+    result["energy"] = profile.charge * _settings->value("PowerSampler/supplyVoltage", 24.0).toDouble();
+    result["peakCurrent"] = profile.peakCurrent;
+    result["peakStep"] = _powerSteps.value(profile.peakStep);
+    result["min24V"] = profile.min24V;
+    result["min3V"] = profile.min3V;
+
+    return result;
+}
+
+void TestClient::finishPowerProfile()
+{
+    for (int slot = 1; slot <= DUT_COUNT; slot++)
+    {
+        QVariantMap profile = powerProfile(slot);
+
+        if (!isDutAvailable(slot) || profile.value("samples").toULongLong() == 0)
+            continue;
+
+        setDutProperty(slot, "energy", profile.value("energy"));
+        setDutProperty(slot, "peakCurrent", profile.value("peakCurrent"));
+    }
+
+    if (_powerSampler.dropped())
+        qWarning() << "Measuring board" << _no << "power samples dropped:" << _powerSampler.dropped();
+
+    _powerSampler.clear();
+    _powerFaults = 0;
+}
+
+bool TestClient::startCapture(const QString &path)
+{
+    if (!_portManager.startCapture(path))
+        return false;
+
+    if (_logger)
+        _logger->logDebug(QString("Measuring Board %1 link capture: %2").arg(_no).arg(path));
+
+    return true;
+}
+
 QStringList TestClient::availiblePorts() const
 {
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    QStringList list;
-    for (auto & portInfo : availablePorts)
+    QStringList list = PortRegistry::instance()->serialNumbers();
+
+    // Ports bound to a board ID in the settings, e.g. PTYs of the measuring board simulator
+    _settings->beginGroup("SerialPorts");
+    for (auto & id : _settings->childKeys())
     {
-        list.push_back(portInfo.serialNumber());
+        if (!list.contains(id))
+            list.push_back(id);
     }
+    _settings->endGroup();
+
     return list;
 }
 
 void TestClient::open(QString id)
 {
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    for (auto & portInfo : availablePorts)
+    _portId = id;
+
+    QString portName = _settings->value("SerialPorts/" + id).toString();
+
+    if (portName.isEmpty())
+        portName = PortRegistry::instance()->portName(id);
+
+    if (portName.isEmpty())
+    {
+        _logger->logDebug(QString("Port %1 of the Measuring Board %2 is not attached").arg(id).arg(_no));
+
+        return;
+    }
+
+    _portManager.setPort(portName);
+    if(openPort())
     {
-        if(portInfo.serialNumber() == id)
+        if(readCSA(0) != NO_RESPONSE)
         {
-            _portManager.setPort(portInfo.portName());
-            if(_portManager.open())
-            {
-                if(readCSA(0) != NO_RESPONSE)
-                {
-                    _isConnected = true;
-                    _logger->logDebug(QString("Connection to the Measuring Board %1 has been established on %2").arg(_no).arg(portInfo.portName()));
-                }
-                else
-                    _logger->logDebug(QString("Connection to the Measuring Board %1 has NOT been established").arg(_no));
-                break;
-            }
-            else
-            {
-                _logger->logError(QString("Error occured when opening COM port %1 for the Measuring Board %2").arg(portInfo.portName()).arg(_no));
-                _logger->logDebug(QString("Error occured when opening COM port %1 for the Measuring Board %2").arg(portInfo.portName()).arg(_no));
-            }
+            _isConnected = true;
+            _logger->logDebug(QString("Connection to the Measuring Board %1 has been established on %2").arg(_no).arg(portName));
+
+            int interval = _settings->value("PowerSampler/interval", 0).toInt();
+
+            if (interval > 0)
+                startPowerSampling(interval, _settings->value("PowerSampler/rails", false).toBool(), _settings->value("PowerSampler/peakLimit", 0).toInt());
         }
+        else
+            _logger->logDebug(QString("Connection to the Measuring Board %1 has NOT been established").arg(_no));
+    }
+    else
+    {
+        _logger->logError(QString("Error occured when opening COM port %1 for the Measuring Board %2").arg(portName).arg(_no));
+        _logger->logDebug(QString("Error occured when opening COM port %1 for the Measuring Board %2").arg(portName).arg(_no));
     }
 }
 
+void TestClient::onPortAttached(const QString &serialNumber)
+{
+    if (serialNumber != _portId || _isConnected)
+        return;
+
+    _logger->logInfo(QString("Measuring Board %1 has been attached, reconnecting").arg(_no));
+    open(_portId);
+}
+
+void TestClient::onPortDetached(const QString &serialNumber)
+{
+    if (serialNumber != _portId || !_isConnected)
+        return;
+
+    _portManager.close();
+    _isConnected = false;
+    _logger->logError(QString("Measuring Board %1 has been detached").arg(_no));
+}
+
 void TestClient::setDutsNumbers(QString numbers)
 {
     auto numberList = numbers.simplified().split("|");
     int slot = 1;
     for(auto & i : numberList)
     {
-        _duts[slot]["no"] = i.toInt();
+        _duts[slotIndex(slot)].no = i.toInt();
         slot++;
     }
 }
 
 void TestClient::setDutChecked(int no, bool checked)
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_COUNT; slot++)
     {
-        if(dut["no"].toInt() == no)
+        if(_duts[slot].no == no)
         {
-            dut["checked"] = checked;
+            _duts[slot].setFlag(Dut::Checked, checked);
             break;
         }
     }
@@ -109,24 +314,27 @@ void TestClient::setDutChecked(int no, bool checked)
 
 void TestClient::addDutError(int slot, QString error)
 {
-    setDutProperty(slot, "error", _duts[slot]["error"].toString() + ";" + error);
+    QMutexLocker locker(&_dutMutex);
+
+    _duts[slotIndex(slot)].addError(error);
+    markDutChanged(slot, Dut::Error);
 }
 
 void TestClient::setAllDutsChecked()
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_COUNT; slot++)
     {
-        if(dut["state"].toBool())
-            dut["checked"] = true;
+        if(_duts[slot].state)
+            _duts[slot].setFlag(Dut::Checked, true);
     }
 }
 
 void TestClient::reverseDutsChecked()
 {
-    for(auto & dut : _duts)
+    for(int slot = 1; slot <= DUT_COUNT; slot++)
     {
-        if(dut["state"].toBool())
-            dut["checked"] = !dut["checked"].toBool();
+        if(_duts[slot].state)
+            _duts[slot].setFlag(Dut::Checked, !_duts[slot].flag(Dut::Checked));
     }
 }
 
@@ -134,580 +342,687 @@ void TestClient::reverseDutsChecked()
 int TestClient::switchSWD(int slot)
 {
     _currentSlot = slot;
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t dut;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_SWD);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 1;
-    pkt.dut = slot;
-
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
-
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
-
-    return NO_RESPONSE;
+    return boardCommand<MB_SwitchSwd>(slot);
 }
 
-
 int TestClient::powerOn(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                state;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
+    return boardCommand<MB_SwitchPower>(slot, 1);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_POWER);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.state = 1;
+int TestClient::powerOff(int slot)
+{
+    // Railtest starts at the default speed after the next power-on
+    int defaultBaudRate = _settings->value("DutDebug/defaultBaudRate", 115200).toInt();
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+    if (slot >= 1 && slot <= 3 && _dutBaudRate[slot] && _dutBaudRate[slot] != defaultBaudRate)
+        configureDutDebug(slot, defaultBaudRate);
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    return boardCommand<MB_SwitchPower>(slot, 0);
+}
 
-    return NO_RESPONSE;
+int TestClient::readDIN(int slot, int DIN)
+{
+    return boardCommand<MB_ReadDin>(slot, DIN);
 }
 
-int TestClient::powerOff(int slot)
+int TestClient::setDOUT(int slot, int DOUT)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                state;
-    };
-#pragma pack (pop)
+    return boardCommand<MB_WriteDout>(slot, DOUT, 1);
+}
 
-    Pkt pkt;
+int TestClient::clearDOUT(int slot, int DOUT)
+{
+    return boardCommand<MB_WriteDout>(slot, DOUT, 0);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_POWER);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.state = 0;
+int TestClient::readCSA(int gain)
+{
+    return boardCommand<MB_ReadCsa>(gain);
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+int TestClient::readAIN(int slot, int AIN, int gain)
+{
+    _currentSlot = slot;
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    return boardCommand<MB_ReadAnalog>(slot, AIN, gain);
+}
 
-    return NO_RESPONSE;
+int TestClient::daliOn()
+{
+    return boardCommand<MB_SwitchDali>(1);
 }
 
-int TestClient::readDIN(int slot, int DIN)
+int TestClient::daliOff()
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                din;
-    };
-#pragma pack (pop)
+    return boardCommand<MB_SwitchDali>(0);
+}
 
-    Pkt pkt;
+int TestClient::readDaliADC()
+{
+    return boardCommand<MB_ReadDaliAdc>();
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DIN);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.din = DIN;
+int TestClient::readDinADC(int slot, int DIN)
+{
+    return boardCommand<MB_ReadDinAdc>(slot, DIN);
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+int TestClient::read24V()
+{
+    return boardCommand<MB_Read24V>();
+}
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+int TestClient::read3V()
+{
+    return boardCommand<MB_Read3V>();
+}
 
-    return NO_RESPONSE;
+int TestClient::readTemperature()
+{
+    return boardCommand<MB_ReadTemperature>();
 }
 
-int TestClient::setDOUT(int slot, int DOUT)
+int TestClient::configureDutDebug(int slot, int baudRate, int bits, int parity, int stopBits)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                dout,
-                state;
-    };
-#pragma pack (pop)
+    int result = boardCommand<MB_ConfigDutDebug>(slot, quint32(baudRate), bits, parity, stopBits);
 
-    Pkt pkt;
+    if (result == MB_NO_ERROR && slot >= 1 && slot <= 3)
+        _dutBaudRate[slot] = baudRate;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_WRITE_DOUT);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.dout = DOUT;
-    pkt.state = 1;
+    return result;
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+QVariantMap TestClient::sampleAIN(int slot, int AIN, int gain, int n)
+{
+    return sampleBoard<MB_ReadAnalog>(n, slot, AIN, gain);
+}
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+QVariantMap TestClient::sampleDinADC(int slot, int DIN, int n)
+{
+    return sampleBoard<MB_ReadDinAdc>(n, slot, DIN);
+}
 
-    return NO_RESPONSE;
+QVariantMap TestClient::sampleCSA(int gain, int n)
+{
+    return sampleBoard<MB_ReadCsa>(n, gain);
 }
 
-int TestClient::clearDOUT(int slot, int DOUT)
+QVariantMap TestClient::sampleDaliADC(int n)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                dout,
-                state;
-    };
-#pragma pack (pop)
+    return sampleBoard<MB_ReadDaliAdc>(n);
+}
 
-    Pkt pkt;
+QVariantMap TestClient::sampleResult(const SampleStats &stats, int failed)
+{
+    QVariantMap result;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_WRITE_DOUT);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.dout = DOUT;
-    pkt.state = 0;
+    result["count"] = stats.count();
+    result["failed"] = failed;
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+    if (stats.count() == 0)
+        return result;
 
-    if(response.size())
-    {
-        return response.last().toInt();
-    }
+    result["min"] = stats.min();
+    result["max"] = stats.max();
+    result["mean"] = stats.mean();
+    result["stddev"] = stats.stddev();
+    result["median"] = stats.median();
 
-    return NO_RESPONSE;
+    return result;
 }
 
-int TestClient::readCSA(int gain)
+QVariantList TestClient::batch(const QVariantList &commands)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t gain;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
+    startBatch(commands);
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_CSA);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 1;
-    pkt.gain = gain;
+    return finishBatch();
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+void TestClient::startBatch(const QVariantList &commands)
+{
+    if (!_batch.done)
+        finishBatch();
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    _batchResults.fill(NO_RESPONSE, commands.size());
 
-    return NO_RESPONSE;
+    _portManager.holdWrites();
+    for (int i = 0; i < commands.size(); i++)
+        queueBoardCommand(&_batch, &_batchResults[i], commands.at(i).toList());
+    _portManager.releaseWrites();
 }
 
-int TestClient::readAIN(int slot, int AIN, int gain)
+QVariantList TestClient::finishBatch()
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                ain,
-                gain;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
+    QVariantList results;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ANALOG);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 3;
-    pkt.dut = slot;
-    pkt.ain = AIN;
-    pkt.gain = gain;
+    waitForBatch(_batch);
+    for (auto result : _batchResults)
+        results.append(result);
 
-    _currentSlot = slot;
+    return results;
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+void TestClient::startSampleBatch(const QVariantList &commands, int n)
+{
+    QVariantList burst;
 
-    if(response.size())
+    _batchSamples = qMax(1, n);
+    for (auto & command : commands)
     {
-        return response[0].toInt();
+        for (int i = 0; i < _batchSamples; i++)
+            burst.append(command);
     }
 
-    return NO_RESPONSE;
+    startBatch(burst);
 }
 
-int TestClient::daliOn()
+QVariantList TestClient::finishSampleBatch()
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-        uint8_t state;
-    };
-#pragma pack (pop)
+    QVariantList results;
 
-    Pkt pkt;
-
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_DALI);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 1;
-    pkt.state = 1;
+    waitForBatch(_batch);
+    for (int i = 0; i + _batchSamples <= _batchResults.size(); i += _batchSamples)
+    {
+        SampleStats stats;
+        int failed = 0;
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+        for (int k = i; k < i + _batchSamples; k++)
+        {
+            if (_batchResults[k] >= 0)
+                stats.add(_batchResults[k]);
+            else
+                ++failed;
+        }
 
-    if(response.size())
-    {
-        return response[0].toInt();
+        results.append(sampleResult(stats, failed));
     }
 
-    return NO_RESPONSE;
+    return results;
 }
 
-int TestClient::daliOff()
+void TestClient::queueBoardCommand(BoardBatch *batch, int *result, const QVariantList &command)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    // Script names of the commands in BoardCommands.h, a[] holds the numbers after the name.
+    static const QHash<QString, BatchCommand> commands =
     {
-        MB_Packet_t h;
-        uint8_t state;
+        {"switchSWD", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_SwitchSwd>(b, r, a[0]);}},
+        {"powerOn", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_SwitchPower>(b, r, a[0], 1);}},
+        {"powerOff", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->queuePowerOff(b, r, a[0]);}},
+        {"readDIN", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_ReadDin>(b, r, a[0], a[1]);}},
+        {"setDOUT", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_WriteDout>(b, r, a[0], a[1], 1);}},
+        {"clearDOUT", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_WriteDout>(b, r, a[0], a[1], 0);}},
+        {"readCSA", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_ReadCsa>(b, r, a[0]);}},
+        {"readAIN", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_ReadAnalog>(b, r, a[0], a[1], a[2]);}},
+        {"daliOn", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_SwitchDali>(b, r, 1);}},
+        {"daliOff", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_SwitchDali>(b, r, 0);}},
+        {"readDaliADC", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_ReadDaliAdc>(b, r);}},
+        {"readDinADC", [](TestClient *c, BoardBatch *b, int *r, const int *a) {c->boardCommandAsync<MB_ReadDinAdc>(b, r, a[0], a[1]);}},
+        {"read24V", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_Read24V>(b, r);}},
+        {"read3V", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_Read3V>(b, r);}},
+        {"readTemperature", [](TestClient *c, BoardBatch *b, int *r, const int *) {c->boardCommandAsync<MB_ReadTemperature>(b, r);}},
     };
-#pragma pack (pop)
 
-    Pkt pkt;
+    QString name = command.value(0).toString();
+    BatchCommand queue = commands.value(name);
+    int args[3] = {command.value(1).toInt(), command.value(2).toInt(), command.value(3).toInt()};
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_SWITCH_DALI);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 1;
-    pkt.state = 0;
+    if (queue)
+        queue(this, batch, result, args);
+    else
+        qWarning() << "Measuring board batch. Unknown command:" << name;
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+void TestClient::queuePowerOff(BoardBatch *batch, int *result, int slot)
+{
+    int defaultBaudRate = _settings->value("DutDebug/defaultBaudRate", 115200).toInt();
 
-    if(response.size())
+    // As powerOff(): the board UART goes back to the railtest startup speed first
+    if (slot >= 1 && slot <= 3 && _dutBaudRate[slot] && _dutBaudRate[slot] != defaultBaudRate)
     {
-        return response[0].toInt();
+        MB_ConfigDutDebug::Frame frame;
+        int *baudRate = &_dutBaudRate[slot];
+
+        _portManager.waitForQueueSpace();
+        MB_ConfigDutDebug::encode(frame, ++_sequenceCounter, slot, quint32(defaultBaudRate), 8, 0, 1);
+        ++batch->rest;
+        batch->done = false;
+        _portManager.boardCommandAsync(frame.data(), MB_ConfigDutDebug::size, [batch, baudRate](bool replied, qint32 code)
+        {
+            // Kept as is when the board fails, as configureDutDebug() does
+            if (replied && code == MB_NO_ERROR)
+                *baudRate = 0;
+
+            batch->done = (--batch->rest == 0);
+        });
     }
 
-    return NO_RESPONSE;
+    boardCommandAsync<MB_SwitchPower>(batch, result, slot, 0);
 }
 
-int TestClient::readDaliADC()
+bool TestClient::switchDutBaudRate(int slot, int baudRate, bool *unknown)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+    QByteArray command = _settings->value("DutDebug/baudCommand", "setUartBaudRate").toByteArray();
 
-    Pkt pkt;
+    // Railtest replies at the old speed and switches after the prompt
+    RailtestReply reply = _portManager.railtestReply(slot, command + " " + QByteArray::number(baudRate), 500);
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DALI_ADC);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 0;
+    if (unknown)
+        *unknown = reply.records().isEmpty() || reply.contains("error");
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+    return configureDutDebug(slot, baudRate) == MB_NO_ERROR;
+}
+
+bool TestClient::checkDutLink(int slot, const QByteArray &reference)
+{
+    QByteArray command = _settings->value("DutDebug/checkCommand", "getmemw 0x0FE081F0 2").toByteArray();
+    int count = _settings->value("DutDebug/checkCount", 3).toInt();
 
-    if(response.size())
+    for (int i = 0; i < count; i++)
     {
-        return response[0].toInt();
+        RailtestReply reply = _portManager.railtestReply(slot, command, 500);
+
+        if (!reply.isComplete() || reply.text() != reference)
+            return false;
     }
 
-    return NO_RESPONSE;
+    return true;
 }
 
-int TestClient::readDinADC(int slot, int DIN)
+int TestClient::negotiateDutDebug(int slot)
 {
-#pragma pack (push, 1)
-    struct Pkt
+    int defaultBaudRate = _settings->value("DutDebug/defaultBaudRate", 115200).toInt();
+    QString key = QString("DutDebug/baudRate%1").arg(_no);
+    QString failedKey = QString("DutDebug/failedCommand%1").arg(_no);
+    QString baudCommand = _settings->value("DutDebug/baudCommand", "setUartBaudRate").toString();
+    int remembered = _settings->value(key, 0).toInt();
+    QList<int> candidates;
+
+    // The railtest image of the board failed the search with this command before
+    if (_settings->value(failedKey).toString() == baudCommand)
+        return defaultBaudRate;
+
+    for (auto & rate : _settings->value("DutDebug/baudRates").toString().split("|", QString::SkipEmptyParts))
     {
-        MB_Packet_t h;
-        uint8_t
-                dut,
-                din;
-    };
-#pragma pack (pop)
+        int baudRate = rate.toInt();
+        if (baudRate > defaultBaudRate && baudRate != remembered)
+            candidates.append(baudRate);
+    }
 
-    Pkt pkt;
+    std::sort(candidates.begin(), candidates.end(), std::greater<int>());
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_DIN_ADC);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 2;
-    pkt.dut = slot;
-    pkt.din = DIN;
+    // The speed found last time goes first, a full search runs only when it fails
+    if (remembered > defaultBaudRate)
+        candidates.prepend(remembered);
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+    RailtestReply reference = _portManager.railtestReply(slot, _settings->value("DutDebug/checkCommand", "getmemw 0x0FE081F0 2").toByteArray(), 1000);
 
-    if(response.size())
+    if (!reference.isComplete())
     {
-        return response[0].toInt();
+        _logger->logError(QString("DUT %1 does not respond on the debug UART.").arg(dutNo(slot)));
+        return defaultBaudRate;
     }
 
-    return NO_RESPONSE;
-}
+    bool unknown = false;
 
-int TestClient::read24V()
-{
-#pragma pack (push, 1)
-    struct Pkt
+    for (auto baudRate : candidates)
     {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+        if (switchDutBaudRate(slot, baudRate, &unknown) && !unknown && checkDutLink(slot, reference.text()))
+        {
+            _settings->setValue(key, baudRate);
+            _settings->remove(failedKey);
+            _logger->logDebug(QString("Debug UART of DUT %1 is switched to %2 baud.").arg(dutNo(slot)).arg(baudRate));
+            return baudRate;
+        }
 
-    Pkt pkt;
+        switchDutBaudRate(slot, defaultBaudRate);
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_24V);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 0;
+        // No other speed helps while the railtest image lacks the command
+        if (unknown)
+            break;
+    }
+
+    if (!checkDutLink(slot, reference.text()))
+        _logger->logError(QString("Debug UART of DUT %1 is lost after the baud rate negotiation. Power cycle the DUT.").arg(dutNo(slot)));
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+    _settings->setValue(key, defaultBaudRate);
 
-    if(response.size())
+    // A failed link check may be one flaky DUT, only a missing command stops the search for the board
+    if (unknown)
     {
-        return response[0].toInt();
+        _settings->setValue(failedKey, baudCommand);
+        _logger->logDebug(QString("Measuring Board %1: railtest does not know \"%2\", the baud rate search is skipped from now on.").arg(_no).arg(baudCommand));
     }
 
-    return NO_RESPONSE;
+    return defaultBaudRate;
 }
 
-int TestClient::read3V()
+QStringList TestClient::railtestCommand(int channel, const QByteArray &cmd)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
-
-    Pkt pkt;
+    return _portManager.railtestCommand(channel, cmd);
+}
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_3V);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 0;
+QVariantMap TestClient::railtestReply(int channel, const QByteArray &cmd)
+{
+    return _portManager.railtestReply(channel, cmd).toVariantMap();
+}
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+void TestClient::onBoardStarted()
+{
+    // Everything the board was configured with is back to the power-on state.
+    _sequenceCounter = 0;
+    for (auto & baudRate : _dutBaudRate)
+        baudRate = 0;
 
-    if(response.size())
-    {
-        return response[0].toInt();
-    }
+    if (_logger)
+        _logger->logError(QString("Measuring Board %1 has been restarted").arg(_no));
 
-    return NO_RESPONSE;
+    emit boardReset();
 }
 
-int TestClient::readTemperature()
+void TestClient::onBoardEvent(int eventCode)
 {
-#pragma pack (push, 1)
-    struct Pkt
-    {
-        MB_Packet_t h;
-    };
-#pragma pack (pop)
+    emit boardEvent(eventCode, PortManager::eventName(eventCode));
 
-    Pkt pkt;
+    switch (eventCode)
+    {
+        case MB_EVENT_CMDQUEUE_FULL:
+            emit commandQueueFull();
+            break;
 
-    pkt.h.type = qToBigEndian<uint16_t>(MB_READ_ADC_TEMP);
-    pkt.h.sequence = ++_sequenceCounter;
-    pkt.h.dataLen = 0;
+        case MB_EVENT_DUTDBGTX_FULL:
+            emit dutDebugOverflow();
+            break;
 
-    auto response = _portManager.slipCommand(QByteArray((char*)&pkt, sizeof(pkt)));
+        default:
+            if (_logger)
+                _logger->logDebug(QString("Measuring Board %1 event: %2").arg(_no).arg(PortManager::eventName(eventCode)));
+            break;
+    }
+}
 
-    if(response.size())
+QVariantMap TestClient::linkStats() const
+{
+    PortManager::LinkStats stats = _portManager.linkStats();
+    QVariantMap result, events, latency;
+
+    result["port"] = _portManager.portName();
+    result["bytesIn"] = stats.bytesIn;
+    result["bytesOut"] = stats.bytesOut;
+    result["framesIn"] = stats.framesIn;
+    result["framesOut"] = stats.framesOut;
+    result["crcErrors"] = stats.crcErrors;
+    result["escapeErrors"] = stats.escapeErrors;
+    result["shortFrames"] = stats.shortFrames;
+    result["longFrames"] = stats.longFrames;
+    result["timeouts"] = stats.timeouts;
+    result["discardedFrames"] = stats.discardedFrames;
+
+    for (auto it = stats.events.constBegin(); it != stats.events.constEnd(); ++it)
+        events[PortManager::eventName(it.key())] = it.value();
+    result["events"] = events;
+
+    const QHash<QByteArray, LatencyHistogram> &histograms = _portManager.latencyHistograms();
+
+    for (auto it = histograms.constBegin(); it != histograms.constEnd(); ++it)
     {
-        return response[0].toInt();
+        QVariantMap item;
+
+        item["count"] = it->count();
+        item["p50"] = it->percentile(50);
+        item["p90"] = it->percentile(90);
+        item["p99"] = it->percentile(99);
+        item["p999"] = it->percentile(99.9);
+        latency[QString::fromLatin1(it.key())] = item;
     }
+    result["latency"] = latency;
 
-    return NO_RESPONSE;
+    return result;
 }
 
-QStringList TestClient::railtestCommand(int channel, const QByteArray &cmd)
+QVariantList TestClient::railtestCommands(const QVariantList &slotList, const QByteArray &cmd)
 {
-    return _portManager.railtestCommand(channel, cmd);
+    QList<QPair<int, QByteArray>> commands;
+    QVariantList responses;
+
+    for (auto & slot : slotList)
+        commands.append(qMakePair(slot.toInt(), cmd));
+
+    for (auto & reply : _portManager.railtestCommands(commands))
+        responses.append(reply.toVariantMap());
+
+    return responses;
 }
 
-void TestClient::testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count)
+bool TestClient::testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count)
 {
     Q_UNUSED(maxRSSI);
 
-    RailtestClient rf;
-    _rssiValues.clear();
+    bool passed = radioTest(slot, RfModuleId, channel, power, minRSSI, count);
 
-    connect(&rf, &RailtestClient::replyReceived, this, &TestClient::onRfReplyReceived);
+    emit radioTested(slot, passed);
 
-    auto availablePorts = QSerialPortInfo::availablePorts();
-    QString portName;
-    for (auto & portInfo : availablePorts)
-    {
-        if(portInfo.serialNumber() == RfModuleId)
-        {
-            portName = portInfo.portName();
-            break;
-        }
-    }
-
-    if (!rf.open(portName))
-    {
-        _logger->logError("Cannot open serial port for reference radio module.");
-        _logger->logDebug("Cannot open serial port for reference radio module.");
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + "Cannot open serial port for reference radio module.";
-        return;
-    }
-
-    rf.syncCommand("reset", "", 2000);
-    if (!rf.waitCommandPrompt())
-    {
-        _logger->logError("Timeout waiting reference radio module command prompt.");
-        _logger->logDebug("Timeout waiting reference radio module command prompt.");
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + "Timeout waiting reference radio module command prompt.";
-        return;
-    }
+    return passed;
+}
 
-    rf.syncCommand("rx", "0", 500);
-    _rfRSSI = 255;
-    _rfCount = 0;
-    rf.syncCommand("setBleMode", "1", 500);
-    rf.syncCommand("setBle1Mbps", "1", 500);
-    rf.syncCommand("setChannel", QString().setNum(channel).toLocal8Bit(), 500);
+bool TestClient::radioTest(int slot, const QString &RfModuleId, int channel, int power, int minRSSI, int count)
+{
+    // The DUT is set up before taking the shared reference module.
     railtestCommand(slot, "rx 0");
     railtestCommand(slot, "setBleMode 1");
     railtestCommand(slot, "setBle1Mbps 1");
     railtestCommand(slot, QString("setChannel %1").arg(channel).toLocal8Bit());
     railtestCommand(slot, QString("setPower %1").arg(power).toLocal8Bit());
     railtestCommand(slot, "setTxDelay 25");
-    rf.syncCommand("rx", "1", 500);
-    railtestCommand(slot, QString("tx %1").arg(count).toLocal8Bit());
-    delay(5000);
 
-    double sumRSSI = 0;
-    for (auto & i : _rssiValues)
+    QString error;
+    ReferenceModule *rf = ReferenceRadio::instance()->acquire(RfModuleId, channel, &error);
+
+    if (!rf)
+    {
+        _logger->logError(error);
+        _logger->logDebug(error);
+        addDutError(slot, error);
+        return false;
+    }
+
+    // The sequential mode sends the packets in bursts and stops as soon as the result is
+    // decided, see Sprt.h. The fixed limits below apply when the budget runs out undecided.
+    bool sequential = _settings->value("Radio/sequential", false).toBool();
+    double errorRate = 1.0 - qBound(0.5, _settings->value("Radio/confidence", 0.99).toDouble(), 0.999999);
+    double goodRatio = _settings->value("Radio/goodRatio", 0.95).toDouble();
+    double rssiMargin = _settings->value("Radio/rssiMargin", 5.0).toDouble();
+    double rssiSigma = _settings->value("Radio/rssiSigma", 2.0).toDouble();
+    int burst = sequential ? qMax(1, _settings->value("Radio/burst", 10).toInt()) : count;
+    int timeout = _settings->value("Radio/timeout", 5000).toInt();
+    int idleTimeout = _settings->value("Radio/idleTimeout", 500).toInt();
+    Sprt sprt(errorRate, errorRate);
+    Sprt::Decision packets = Sprt::Continue;
+    Sprt::Decision rssi = Sprt::Continue;
+    SampleStats rssiStats;
+    int sent = 0;
+
+    // Packets of this test only, the module is ours until release().
+    rf->receive(true);
+    while (sent < count && packets != Sprt::Fail && rssi != Sprt::Fail && !(Sprt::Pass == packets && Sprt::Pass == rssi))
     {
-        sumRSSI += i;
+        int n = qMin(burst, count - sent);
+        int expected = rssiStats.count() + n;
+
+        railtestCommand(slot, QString("tx %1").arg(n).toLocal8Bit());
+
+        // Done with the last packet, or when the packets stop coming.
+        rf->waitPackets(expected, timeout, idleTimeout);
+        rssiStats = rf->rssi();
+        sent += n;
+
+        if (!sequential)
+            break;
+
+        int received = qMin(rssiStats.count(), sent);
+        double packetsLlr = Sprt::bernoulliLlr(received, sent, goodRatio, 2.0 / 3.0);
+        double rssiLlr = received ? Sprt::gaussianLlr(received, rssiStats.mean(), qMax(rssiStats.stddev(), rssiSigma), minRSSI + rssiMargin, minRSSI - rssiMargin) : 0.0;
+
+        packets = sprt.decide(packetsLlr);
+        rssi = sprt.decide(rssiLlr);
+        _logger->logDebug(QString("DUT %1 radio sequential test: %2 of %3 packets, RSSI %4, LLR packets %5, RSSI %6")
+                          .arg(dutNo(slot)).arg(received).arg(sent).arg(rssiStats.mean()).arg(packetsLlr).arg(rssiLlr));
     }
-    double averageRSSI = sumRSSI / _rssiValues.size();
 
-    double s0 = 0;
-    foreach(int v, _rssiValues) s0 += pow(v - averageRSSI, 2);
-    s0 = sqrt(s0 / (_rssiValues.size() - 1));
-    _logger->logDebug(QString("For DUT %1 power: %2, packet recieved: %3, Average RSSI: %4, S0: %5.").arg(dutNo(slot)).arg(power).arg(_rssiValues.size()).arg(averageRSSI).arg(s0));
+    bool failed = !rf->receive(false);
+
+    rssiStats = rf->rssi();
+    ReferenceRadio::instance()->release(RfModuleId, failed);
+
+    int received = rssiStats.count();
+    double averageRSSI = rssiStats.mean();
+
+    _logger->logDebug(QString("For DUT %1 power: %2, packet recieved: %3 of %4, Average RSSI: %5, S0: %6.").arg(dutNo(slot)).arg(power).arg(received).arg(sent).arg(averageRSSI).arg(rssiStats.stddev()));
+    setDutField(slot, Dut::Rssi, averageRSSI);
+    setDutField(slot, Dut::Packets, received);
 
-    if (_rfCount < (2 * count / 3))
+    if (Sprt::Fail == packets || (Sprt::Continue == packets && received < (2 * sent / 3)))
     {
         _logger->logError(QString("Radio Interface testing failure for DUT %1.").arg(dutNo(slot)));
-        _logger->logDebug(QString("Radio Interface failure for DUT %1: packet lost (%2).").arg(dutNo(slot)).arg(_rfCount));
-        _duts[slot]["radioChecked"] = false;
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + QString("Radio Interface failure: packet lost (%1).").arg(_rfCount);
+        _logger->logDebug(QString("Radio Interface failure for DUT %1: packet lost (%2).").arg(dutNo(slot)).arg(received));
+        setDutField(slot, Dut::RadioChecked, false);
+        addDutError(slot, QString("Radio Interface failure: packet lost (%1).").arg(received));
+
+        return false;
     }
 
-    else if (averageRSSI < minRSSI)
+    if (Sprt::Fail == rssi || (Sprt::Continue == rssi && averageRSSI < minRSSI))
     {
         _logger->logError(QString("Radio Interface testing failure for DUT %1.").arg(dutNo(slot)));
         _logger->logDebug(QString("Radio Interface failure for DUT %1: RSSI (%2) is out of bounds.").arg(dutNo(slot)).arg(averageRSSI));
-        _duts[slot]["radioChecked"] = false;
-        _duts[slot]["error"] = _duts[slot]["error"].toString() + "; " + QString("Radio Interface failure: RSSI (%1) is out of bounds.").arg(averageRSSI);
-    }
+        setDutField(slot, Dut::RadioChecked, false);
+        addDutError(slot, QString("Radio Interface failure: RSSI (%1) is out of bounds.").arg(averageRSSI));
 
-    else
-    {
-        _logger->logSuccess(QString("Radio interface for DUT %1 has been tested successfully.").arg(dutNo(slot)));
-        _duts[slot]["radioChecked"] = true;
+        return false;
     }
-}
 
-void TestClient::onRfReplyReceived(QString id, QVariantMap params)
-{
-    if (id == "rxPacket" && params.contains("rssi"))
-    {
-        bool ok;
-        int rssi = params.value("rssi").toInt(&ok);
+    _logger->logSuccess(QString("Radio interface for DUT %1 has been tested successfully.").arg(dutNo(slot)));
+    setDutField(slot, Dut::RadioChecked, true);
 
-        if (ok)
-        {
-            ++_rfCount;
-//            _logger->logDebug(QString("RSSI value recieved: %1").arg(rssi));
-            _rssiValues.push_back(rssi);
-            if (rssi < _rfRSSI)
-                _rfRSSI = rssi;
-        }
-    }
+    return true;
 }
 
 void TestClient::delay(int msec)
 {
-    QTime expire = QTime::currentTime().addMSecs(msec);
-    while (QTime::currentTime() <= expire)
-    {
-        QCoreApplication::processEvents();
-    }
+    Station::wait(msec);
 }
 
 void TestClient::resetDut(int slot)
 {
-    _duts[slot]["state"] = DutState::inactive;
-    _duts[slot]["id"] = "";
-    _duts[slot]["checked"] = false;
-    _duts[slot]["voltageChecked"] = false;
-    _duts[slot]["accelChecked"] = false;
-    _duts[slot]["lightSensChecked"] = false;
-    _duts[slot]["daliChecked"] = false;
-    _duts[slot]["radioChecked"] = false;
-    _duts[slot]["error"] = "";
-
-    emit dutChanged(_duts[slot]);
+    setDutField(slot, Dut::State, DutState::inactive);
+    setDutField(slot, Dut::Id, "");
+    setDutField(slot, Dut::Checked, false);
+    setDutField(slot, Dut::VoltageChecked, false);
+    setDutField(slot, Dut::AccelChecked, false);
+    setDutField(slot, Dut::LightSensChecked, false);
+    setDutField(slot, Dut::DaliChecked, false);
+    setDutField(slot, Dut::RadioChecked, false);
+    setDutField(slot, Dut::Error, "");
 }
 
 void TestClient::setDutProperty(int slot, const QString &property, const QVariant &value)
 {
-    _duts[slot][property] = value;
-    emit dutChanged(_duts[slot]);
+    QMutexLocker locker(&_dutMutex);
+    Dut::Field field = _duts[slotIndex(slot)].setProperty(property, value);
+
+    if (field != Dut::Extra)
+        markDutChanged(slot, field);
 }
 
 QVariant TestClient::dutProperty(int slot, const QString &property)
 {
-    return _duts[slot][property];
+    return _duts[slotIndex(slot)].property(property);
+}
+
+void TestClient::setDutField(int slot, Dut::Field field, const QVariant &value)
+{
+    QMutexLocker locker(&_dutMutex);
+
+    _duts[slotIndex(slot)].setValue(field, value);
+    markDutChanged(slot, field);
+}
+
+void TestClient::markDutChanged(int slot, Dut::Field field)
+{
+    int index = slotIndex(slot);
+
+    if (!index)
+        return;
+
+    _dutChanges[index] |= Dut::fieldBit(field);
+
+    // The first change after a flush starts the timer in the client thread
+    if (!_dutFlushPending)
+    {
+        _dutFlushPending = true;
+        QMetaObject::invokeMethod(this, "scheduleDutFlush", Qt::QueuedConnection);
+    }
+}
+
+void TestClient::scheduleDutFlush()
+{
+    _dutTimer.start();
+}
+
+void TestClient::flushDutChanges()
+{
+    struct Delta
+    {
+        int no;
+        quint32 fields;
+        QVariantList values;
+    } deltas[DUT_COUNT];
+    int count = 0;
+
+    // Values of the changed fields only, taken together with the masks
+    {
+        QMutexLocker locker(&_dutMutex);
+
+        _dutFlushPending = false;
+        for (int slot = 1; slot <= DUT_COUNT; slot++)
+        {
+            quint32 fields = _dutChanges[slot];
+
+            if (!fields)
+                continue;
+
+            Delta &delta = deltas[count++];
+
+            delta.no = _duts[slot].no;
+            delta.fields = fields;
+            for (int field = 0; field < Dut::FIELD_COUNT; ++field)
+            {
+                if (fields & Dut::fieldBit((Dut::Field)field))
+                    delta.values.append(_duts[slot].value((Dut::Field)field));
+            }
+
+            _dutChanges[slot] = 0;
+        }
+    }
+
+    for (int i = 0; i < count; i++)
+        emit dutChanged(deltas[i].no, deltas[i].fields, deltas[i].values);
+}
+
+QList<Dut> TestClient::getDuts() const
+{
+    QList<Dut> duts;
+
+    for(int slot = 1; slot <= DUT_COUNT; slot++)
+        duts.append(_duts[slot]);
+
+    return duts;
 }
 
 bool TestClient::isActive() const
 {
-    for(int slot = 1; slot < _duts.size() + 1; slot++)
+    for(int slot = 1; slot <= DUT_COUNT; slot++)
     {
         if(isDutAvailable(slot) && isDutChecked(slot))
         {
@@ -2,12 +2,21 @@
 #define TESTCLIENT_H
 
 #include "SlipProtocol.h"
+#include "BoardCommands.h"
+#include "SampleStats.h"
+#include "PowerSampler.h"
+#include "Sprt.h"
 #include "PortManager.h"
 #include "JLinkManager.h"
 #include "TestMethodManager.h"
 #include "SessionManager.h"
 #include "Logger.h"
 #include "RailtestClient.h"
+#include "PortRegistry.h"
+#include "ReferenceRadio.h"
+#include "Station.h"
+
+#include <atomic>
 
 class TestClient : public QObject
 {
@@ -15,9 +24,10 @@ class TestClient : public QObject
 
 public:
 
-
     enum DutState {inactive, untested, tested, warning};
 
+    static constexpr int NO_RESPONSE = -100;
+
     explicit TestClient(const QSharedPointer<QSettings> &settings, int no, QObject *parent = nullptr);
     ~TestClient();
 
@@ -27,7 +37,7 @@ public:
     void setPort(const QString& portName);
     void open();
 
-    QMap<int, Dut> getDuts() {return _duts;}
+    QList<Dut> getDuts() const;
 
 public slots:
 
@@ -39,20 +49,20 @@ public slots:
     bool isActive() const; //True, if at least one DUT connected
     bool isConnected() const {return _isConnected;}
 
-    int dutsCount() const {return _duts.size();}
-    Dut dut(int slot) const {return _duts[slot];}
+    int dutsCount() const {return DUT_COUNT;}
+    QVariantMap dut(int slot) const {return _duts[slotIndex(slot)].toVariantMap();}
     void setCurrentSlot(int slot) {_currentSlot = slot;}
 
     void setDutProperty(int slot, const QString& property, const QVariant& value);
     QVariant dutProperty(int slot, const QString& property);
 
-    int dutNo(int slot) const {return _duts[slot]["no"].toInt();}
+    int dutNo(int slot) const {return _duts[slotIndex(slot)].no;}
 
-    int dutState(int slot) const {return _duts[slot]["state"].toInt();}
-    void setDutState(int slot, int state) {_duts[slot]["state"] = state;}
+    int dutState(int slot) const {return _duts[slotIndex(slot)].state;}
+    void setDutState(int slot, int state) {_duts[slotIndex(slot)].state = state;}
 
-    bool isDutAvailable(int slot) const {return _duts[slot]["state"].toBool();}
-    bool isDutChecked(int slot) const {return _duts[slot]["checked"].toBool();}
+    bool isDutAvailable(int slot) const {return _duts[slotIndex(slot)].state != DutState::inactive;}
+    bool isDutChecked(int slot) const {return _duts[slotIndex(slot)].flag(Dut::Checked);}
     void setDutChecked(int no, bool checked);
 
     void addDutError(int slot, QString error);
@@ -79,45 +89,264 @@ public slots:
     int read24V();
     int read3V();
     int readTemperature();
+    int configureDutDebug(int slot, int baudRate, int bits = 8, int parity = 0, int stopBits = 1);
+
+    // Bursts of n pipelined reads. Return {count, failed, min, max, mean, stddev, median} of
+    // the valid raw values, the statistics are left out when no read succeeded. The median
+    // is exact up to 32 reads, see SampleStats.h.
+    QVariantMap sampleAIN(int slot, int AIN, int gain, int n);
+    QVariantMap sampleDinADC(int slot, int DIN, int n);
+    QVariantMap sampleCSA(int gain, int n);
+    QVariantMap sampleDaliADC(int n);
+
+    // Raises the DUT railtest console and the board UART to the fastest baud rate that passes
+    // the loopback check. The result is remembered per measuring board. A baud rate command the railtest
+    // image does not know (no reply or an error) is remembered and not tried again until
+    // DutDebug/baudCommand changes or DutDebug/failedCommand<board> is removed. Returns the baud rate in use.
+    int negotiateDutDebug(int slot);
+
+    // Board commands given as lists, e.g. [["powerOn", 1], ["readAIN", 1, 4, 0]], are sent
+    // in one write and pipelined. Returns the results in the same order, NO_RESPONSE for
+    // the failed or unknown ones.
+    QVariantList batch(const QVariantList &commands);
+
+    // Split form of batch() for the station-wide fan-out: start the batches on every board,
+    // then collect the results board by board. Past PortManager::QUEUE_SIZE commands
+    // startBatch() waits for the replies of the first ones before it queues the rest.
+    void startBatch(const QVariantList &commands);
+    QVariantList finishBatch();
+
+    // Burst form of the split batch: every command goes n times, e.g. [["readAIN", 1, 1, 0]].
+    // finishSampleBatch() returns the statistics of each command as sampleAIN() does.
+    void startSampleBatch(const QVariantList &commands, int n);
+    QVariantList finishSampleBatch();
 
     QStringList railtestCommand(int channel, const QByteArray &cmd);
-    void testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count);
+    QVariantMap railtestReply(int channel, const QByteArray &cmd);
+    QVariantList railtestCommands(const QVariantList &slotList, const QByteArray &cmd);
+
+    // Radio test of the DUT against the reference module, true if passed. Ends with radioTested().
+    bool testRadio(int slot, QString RfModuleId, int channel, int power, int minRSSI, int maxRSSI, int count);
+
+    // Fixed timeout of the board and railtest commands, 0 - adaptive per command type.
+    void setTimeout(int value) {_portManager.setTimeout(value);}
+
+    // Measuring board link counters: bytes, frames, SLIP errors, timeouts, board events
+    // and reply latency percentiles (usecs) per command type.
+    QVariantMap linkStats() const;
+    void resetLinkStats() {_portManager.resetLinkStats();}
+
+    // Raw link capture for the offline replay, see LinkTrace.h.
+    bool startCapture(const QString &path);
+    void stopCapture() {_portManager.stopCapture();}
+
+    // Background supply sampling on the board thread, see PowerSampler.h: CSA every msecs and
+    // the 24V/3V rails when asked, skipped while the scripts use the port. A current above
+    // peakLimit (mA, 0 - no limit) is reported at once by powerFault(). msecs = 0 stops it.
+    void startPowerSampling(int msecs, bool rails = false, int peakLimit = 0);
+    void stopPowerSampling() {startPowerSampling(0);}
+
+    // Test step the following samples are tagged with.
+    void setPowerStep(const QString &step);
 
-    void setTimeout(int value) { Q_UNUSED(value); }
+    // {samples, charge (mA*s), energy (mJ), peakCurrent, peakStep, min24V, min3V} of the slot.
+    // The board current is charged to the active slot whole, see PowerSampler.h.
+    QVariantMap powerProfile(int slot);
+
+    // Stores energy and peakCurrent to the DUT properties and starts the profiles over.
+    void finishPowerProfile();
 
 signals:
 
 //    void responseRecieved(QStringList response);
 
-    void dutChanged(Dut);
+    // Changed fields of the DUT with the given number as Dut::fieldBit() bits and their values
+    // in the field order. Field writes are coalesced, at most one notification per DUT every
+    // GUI/dutRefreshInterval ms.
+    void dutChanged(int no, quint32 fields, const QVariantList &values);
     void dutFullyTested(Dut);
     void slotFullyTested(int);
     void commandSequenceStarted();
     void commandSequenceFinished();
 
+    // Measuring board notifications. Command throttling and resync are done before they are emitted,
+    // the slots are called while the reply data is decoded and must not send blocking commands.
+    void boardReset();
+    void commandQueueFull();
+    void dutDebugOverflow();
+    void boardEvent(int eventCode, const QString &name);
+
+    // Emitted from the board thread, once per slot until finishPowerProfile().
+    void powerFault(int slot, int current);
+
+    void radioTested(int slot, bool passed);
+
 private slots:
 
-    void onRfReplyReceived(QString id, QVariantMap params);
+    void onBoardStarted();
+    void onBoardEvent(int eventCode);
+    void onPortAttached(const QString &serialNumber);
+    void onPortDetached(const QString &serialNumber);
     void delay(int msec);
+    void runPowerSampler(int msecs, bool rails, int peakLimit);
+    void onPowerSample();
+    void scheduleDutFlush();
+    void flushDutChanges();
 
 private:
 
+    // Measuring board command from the table in BoardCommands.h: the decoded result or NO_RESPONSE.
+    template <typename Command, typename... Args>
+    int boardCommand(Args... args)
+    {
+        typename Command::Frame frame;
+        qint32 result;
+
+        Command::encode(frame, ++_sequenceCounter, args...);
+        if (!_portManager.boardCommand(frame.data(), Command::size, &result))
+            return NO_RESPONSE;
+
+        return Command::decode(result);
+    }
+
+    // Completion of the pipelined commands.
+    struct BoardBatch
+    {
+        int rest = 0;
+        bool done = true;
+    };
+
+    // Pipelined variant: the command is queued behind the ones in flight, the decoded result
+    // or NO_RESPONSE is stored to *result. Waits for the replies while the port queue is full.
+    // The handler captures two pointers only, so std::function keeps it in place.
+    template <typename Command, typename... Args>
+    void boardCommandAsync(BoardBatch *batch, int *result, Args... args)
+    {
+        typename Command::Frame frame;
+
+        _portManager.waitForQueueSpace();
+        Command::encode(frame, ++_sequenceCounter, args...);
+        ++batch->rest;
+        batch->done = false;
+        _portManager.boardCommandAsync(frame.data(), Command::size, [batch, result](bool replied, qint32 code)
+        {
+            *result = replied ? Command::decode(code) : NO_RESPONSE;
+            batch->done = (--batch->rest == 0);
+        });
+    }
+
+    void waitForBatch(const BoardBatch &batch) {_portManager.waitForReply(batch.done);}
+
+    // Background command, false if the port is in use, there is no reply or the board fails.
+    template <typename Command, typename... Args>
+    bool tryBoardCommand(qint32 *value, Args... args)
+    {
+        typename Command::Frame frame;
+        qint32 result;
+
+        Command::encode(frame, ++_sequenceCounter, args...);
+        if (!_portManager.tryBoardCommand(frame.data(), Command::size, &result))
+            return false;
+
+        *value = Command::decode(result);
+
+        return *value >= 0;
+    }
+
+    // Burst of n reads of the same command, accumulated as the replies arrive. Negative
+    // values are board errors and counted as failed. Reads past PortManager::QUEUE_SIZE
+    // are queued as the replies free the queue.
+    template <typename Command, typename... Args>
+    QVariantMap sampleBoard(int n, Args... args)
+    {
+        struct Burst
+        {
+            SampleStats stats;
+            int failed = 0;
+            int rest = 0;
+            bool done = true;
+        } burst;
+
+        _portManager.holdWrites();
+        for (int i = 0; i < n; i++)
+        {
+            typename Command::Frame frame;
+
+            _portManager.waitForQueueSpace();
+            Command::encode(frame, ++_sequenceCounter, args...);
+            ++burst.rest;
+            burst.done = false;
+            _portManager.boardCommandAsync(frame.data(), Command::size, [&burst](bool replied, qint32 code)
+            {
+                typename Command::ResultType value = Command::decode(code);
+
+                if (replied && value >= 0)
+                    burst.stats.add(value);
+                else
+                    ++burst.failed;
+
+                burst.done = (--burst.rest == 0);
+            });
+        }
+        _portManager.releaseWrites();
+        _portManager.waitForReply(burst.done);
+
+        return sampleResult(burst.stats, burst.failed);
+    }
+
+    // Queues a batch command with its arguments, see queueBoardCommand().
+    typedef void (*BatchCommand)(TestClient *client, BoardBatch *batch, int *result, const int *args);
+
+    static QVariantMap sampleResult(const SampleStats &stats, int failed);
+    void queueBoardCommand(BoardBatch *batch, int *result, const QVariantList &command);
+    void queuePowerOff(BoardBatch *batch, int *result, int slot);
+
+    bool radioTest(int slot, const QString &RfModuleId, int channel, int power, int minRSSI, int count);
+    bool switchDutBaudRate(int slot, int baudRate, bool *unknown = nullptr);
+    bool checkDutLink(int slot, const QByteArray &reference);
+    void loadLatency();
+    bool openPort();
+    void setDutField(int slot, Dut::Field field, const QVariant &value);
+
+    // Marks the field for the next dutChanged() flush, called with _dutMutex held.
+    void markDutChanged(int slot, Dut::Field field);
+
+    // Slot 0 absorbs out of range slot numbers from the scripts.
+    static int slotIndex(int slot) {return (slot >= 1 && slot <= DUT_COUNT) ? slot : 0;}
+    void saveLatency();
+
     PortManager _portManager;
     int _no;
     QSharedPointer<QSettings> _settings;
     QSharedPointer<Logger> _logger;
 
-    QMap<int, Dut> _duts;
+    static constexpr int DUT_COUNT = 3;
 
-    bool _isConnected = false;
-    int _currentSlot = 0;
-
-    int _rfRSSI;
-    int _rfCount;
+    QMutex _dutMutex;                       // Guards the notified DUT writes and the changes below
+    Dut _duts[DUT_COUNT + 1];
+    quint32 _dutChanges[DUT_COUNT + 1] = {};    // Dut::fieldBit() bits not yet sent to the GUI
+    bool _dutFlushPending = false;
+    QTimer _dutTimer;
 
-    QVector<int> _rssiValues;
-
-    uint8_t _sequenceCounter = 0;
+    bool _isConnected = false;
+    QString _portId;                        // USB serial number given to open(), followed across replugs
+    std::atomic<int> _currentSlot {0};     // Read by the power sampler
+
+    int _dutBaudRate[4] = {0, 0, 0, 0};     // Board side DUT UART speed, 0 - default
+
+    std::atomic<quint8> _sequenceCounter {0};   // Shared with the power sampler
+    BoardBatch _batch;
+    QVector<int> _batchResults;             // Not resized while the batch is in flight
+    int _batchSamples = 1;                  // Results per command of the sample batch
+
+    PowerSampler _powerSampler;
+    QTimer _powerTimer;
+    QElapsedTimer _powerClock;
+    bool _powerRails = false;               // Board thread only
+    int _powerPeakLimit = 0;
+    std::atomic<int> _powerStep {0};
+    std::atomic<quint32> _powerFaults {0};  // Slot bits reported by powerFault()
+    QStringList _powerSteps;
 };
 
 #endif // TESTCLIENT_H
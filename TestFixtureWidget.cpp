@@ -128,8 +128,23 @@ void TestFixtureWidget::reset()
     }
 }
 
-void TestFixtureWidget::refreshButtonState(Dut dut)
+void TestFixtureWidget::refreshButtonState(int no, quint32 fields, const QVariantList &values)
 {
-    _buttons.at(dut["no"].toInt() - 1)->setButtonState(dut["state"].toInt());
-    _buttons.at(dut["no"].toInt() - 1)->setChecked(dut["checked"].toBool());
+    if (no < 1 || no > _buttons.size())
+        return;
+
+    int index = 0;
+
+    for (int field = 0; field < Dut::FIELD_COUNT && index < values.size(); ++field)
+    {
+        if (!(fields & Dut::fieldBit((Dut::Field)field)))
+            continue;
+
+        const QVariant &value = values.at(index++);
+
+        if (Dut::State == field)
+            _buttons.at(no - 1)->setButtonState(value.toInt());
+        else if (Dut::Checked == field)
+            _buttons.at(no - 1)->setChecked(value.toBool());
+    }
 }
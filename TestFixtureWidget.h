@@ -21,7 +21,7 @@ public slots:
 
     void refreshButtonsState();
     void reset();
-    void refreshButtonState(Dut dut);
+    void refreshButtonState(int no, quint32 fields, const QVariantList &values);
 
 signals:
 
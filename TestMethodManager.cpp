@@ -2,11 +2,14 @@
 
 #include <QDebug>
 
+#include "Station.h"
+
 TestMethodManager::TestMethodManager(const QSharedPointer<QSettings> &settings, QObject *parent) : QObject(parent), _settings(settings),  _scriptEngine(this)
 {
     _scriptEngine.installExtensions(QJSEngine::ConsoleExtension);
 
     _scriptEngine.globalObject().setProperty("methodManager", _scriptEngine.newQObject(this));
+    _scriptEngine.globalObject().setProperty("station", _scriptEngine.newQObject(new Station(this)));
     evaluateScriptsFromDirectory(settings->value("workDirectory").toString() + "/sequences");
 }
 
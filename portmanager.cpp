@@ -1,81 +1,32 @@
 #include "portmanager.h"
 
 #include <QtEndian>
-#include <QCoreApplication>
 #include <QDebug>
-#include <QElapsedTimer>
-
-static constexpr char
-    END_SLIP_OCTET = -64, // 0xC0
-    END_SUBS_OCTET = -36, // 0xDC
-    ESC_SLIP_OCTET = -37, // 0xDB
-    ESC_SUBS_OCTET = -35; // 0xDD
-
-static constexpr int MIN_FRAME_SIZE = sizeof(quint8) + sizeof(quint16) + 1;
-
-static const quint16 _crc_ccitt_lut[] = {
-    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50a5, 0x60c6, 0x70e7, 0x8108,
-    0x9129, 0xa14a, 0xb16b, 0xc18c, 0xd1ad, 0xe1ce, 0xf1ef, 0x1231, 0x0210,
-    0x3273, 0x2252, 0x52b5, 0x4294, 0x72f7, 0x62d6, 0x9339, 0x8318, 0xb37b,
-    0xa35a, 0xd3bd, 0xc39c, 0xf3ff, 0xe3de, 0x2462, 0x3443, 0x0420, 0x1401,
-    0x64e6, 0x74c7, 0x44a4, 0x5485, 0xa56a, 0xb54b, 0x8528, 0x9509, 0xe5ee,
-    0xf5cf, 0xc5ac, 0xd58d, 0x3653, 0x2672, 0x1611, 0x0630, 0x76d7, 0x66f6,
-    0x5695, 0x46b4, 0xb75b, 0xa77a, 0x9719, 0x8738, 0xf7df, 0xe7fe, 0xd79d,
-    0xc7bc, 0x48c4, 0x58e5, 0x6886, 0x78a7, 0x0840, 0x1861, 0x2802, 0x3823,
-    0xc9cc, 0xd9ed, 0xe98e, 0xf9af, 0x8948, 0x9969, 0xa90a, 0xb92b, 0x5af5,
-    0x4ad4, 0x7ab7, 0x6a96, 0x1a71, 0x0a50, 0x3a33, 0x2a12, 0xdbfd, 0xcbdc,
-    0xfbbf, 0xeb9e, 0x9b79, 0x8b58, 0xbb3b, 0xab1a, 0x6ca6, 0x7c87, 0x4ce4,
-    0x5cc5, 0x2c22, 0x3c03, 0x0c60, 0x1c41, 0xedae, 0xfd8f, 0xcdec, 0xddcd,
-    0xad2a, 0xbd0b, 0x8d68, 0x9d49, 0x7e97, 0x6eb6, 0x5ed5, 0x4ef4, 0x3e13,
-    0x2e32, 0x1e51, 0x0e70, 0xff9f, 0xefbe, 0xdfdd, 0xcffc, 0xbf1b, 0xaf3a,
-    0x9f59, 0x8f78, 0x9188, 0x81a9, 0xb1ca, 0xa1eb, 0xd10c, 0xc12d, 0xf14e,
-    0xe16f, 0x1080, 0x00a1, 0x30c2, 0x20e3, 0x5004, 0x4025, 0x7046, 0x6067,
-    0x83b9, 0x9398, 0xa3fb, 0xb3da, 0xc33d, 0xd31c, 0xe37f, 0xf35e, 0x02b1,
-    0x1290, 0x22f3, 0x32d2, 0x4235, 0x5214, 0x6277, 0x7256, 0xb5ea, 0xa5cb,
-    0x95a8, 0x8589, 0xf56e, 0xe54f, 0xd52c, 0xc50d, 0x34e2, 0x24c3, 0x14a0,
-    0x0481, 0x7466, 0x6447, 0x5424, 0x4405, 0xa7db, 0xb7fa, 0x8799, 0x97b8,
-    0xe75f, 0xf77e, 0xc71d, 0xd73c, 0x26d3, 0x36f2, 0x0691, 0x16b0, 0x6657,
-    0x7676, 0x4615, 0x5634, 0xd94c, 0xc96d, 0xf90e, 0xe92f, 0x99c8, 0x89e9,
-    0xb98a, 0xa9ab, 0x5844, 0x4865, 0x7806, 0x6827, 0x18c0, 0x08e1, 0x3882,
-    0x28a3, 0xcb7d, 0xdb5c, 0xeb3f, 0xfb1e, 0x8bf9, 0x9bd8, 0xabbb, 0xbb9a,
-    0x4a75, 0x5a54, 0x6a37, 0x7a16, 0x0af1, 0x1ad0, 0x2ab3, 0x3a92, 0xfd2e,
-    0xed0f, 0xdd6c, 0xcd4d, 0xbdaa, 0xad8b, 0x9de8, 0x8dc9, 0x7c26, 0x6c07,
-    0x5c64, 0x4c45, 0x3ca2, 0x2c83, 0x1ce0, 0x0cc1, 0xef1f, 0xff3e, 0xcf5d,
-    0xdf7c, 0xaf9b, 0xbfba, 0x8fd9, 0x9ff8, 0x6e17, 0x7e36, 0x4e55, 0x5e74,
-    0x2e93, 0x3eb2, 0x0ed1, 0x1ef0
-};
-
-static inline void _encodeSymbol(QByteArray &buffer, char ch) Q_DECL_NOTHROW
-{
-    switch (ch)
-    {
-        case END_SLIP_OCTET:
-            buffer.append(ESC_SLIP_OCTET);
-            buffer.append(END_SUBS_OCTET);
-            break;
+#include <QThread>
+#include <QVector>
 
-        case ESC_SLIP_OCTET:
-            buffer.append(ESC_SLIP_OCTET);
-            buffer.append(ESC_SUBS_OCTET);
-            break;
+#include <string.h>
 
-        default:
-            buffer.append(ch);
-    }
+static inline void _reply(const PortManager::BoardHandler &handler, bool replied, qint32 result = 0)
+{
+    if (handler)
+        handler(replied, result);
 }
 
-static int _restTime(int timeout, int elapsed)
+static inline void _reply(const PortManager::RailtestHandler &handler, const RailtestReply &reply)
 {
-    if (timeout < 0)
-        return -1;
-
-    timeout = timeout - elapsed;
-
-    return timeout < 0 ? 0 : timeout;
+    if (handler)
+        handler(reply);
 }
 
-PortManager::PortManager(QObject *parent) : QObject(parent), _serial(this)
+PortManager::PortManager(QObject *parent) : QObject(parent), _ioMutex(QMutex::Recursive), _serial(this), _timeoutTimer(this)
 {
+    _codec.setFrameHandler([this](int channel, const char *data, int size){onFrameDecoded(channel, data, size);});
+    _clock.start();
+    _timeoutTimer.setSingleShot(true);
+
+    connect(&_serial, &QSerialPort::readyRead, this, &PortManager::onReadyRead);
+    connect(&_timeoutTimer, &QTimer::timeout, this, &PortManager::onTimeout);
 }
 
 void PortManager::setPort(const QString &name, qint32 baudRate, QSerialPort::DataBits dataBits, QSerialPort::Parity parity, QSerialPort::StopBits stopBits, QSerialPort::FlowControl flowControl)
@@ -94,8 +45,10 @@ void PortManager::setPort(const QString &name, qint32 baudRate, QSerialPort::Dat
 
 bool PortManager::open()
 {
+    QMutexLocker locker(&_ioMutex);
+
     if (_serial.isOpen())
-        _serial.close();
+        close();
 
     if (!_serial.open(QSerialPort::ReadWrite))
     {
@@ -104,293 +57,740 @@ bool PortManager::open()
         return false;
     }
 
+    _serial.clear();
+    _codec.reset();
+    resetLinkStats();
+    for (auto & railtest : _railtestChannels)
+        railtest.engine.reset();
+
     return true;
 }
 
 void PortManager::close()
 {
+    QMutexLocker locker(&_ioMutex);
+
     if (_serial.isOpen())
         _serial.close();
+
+    abortCommands();
+    _codec.reset();
+    _holdWrites = false;
+    _heldData.resize(0);
 }
 
-QStringList PortManager::slipCommand(const QByteArray &frame, int msecs)
+bool PortManager::boardCommand(const char *frame, int size, qint32 *result, int msecs)
 {
+    QMutexLocker locker(&_ioMutex);
+
+    // Captures one pointer, so std::function does not allocate.
+    struct
+    {
+        bool done;
+        bool replied;
+        qint32 code;
+    } reply = {false, false, 0};
+
+    boardCommandAsync(frame, size, [&reply](bool replied, qint32 code)
+    {
+        reply.replied = replied;
+        reply.code = code;
+        reply.done = true;
+    }, msecs);
+    waitForReply(reply.done);
+    *result = reply.code;
+
+    return reply.replied;
+}
+
+QStringList PortManager::railtestCommand(int channel, const QByteArray &cmd, int msecs)
+{
+    return railtestReply(channel, cmd, msecs).tokens();
+}
+
+RailtestReply PortManager::railtestReply(int channel, const QByteArray &cmd, int msecs)
+{
+    QMutexLocker locker(&_ioMutex);
+
+    bool done = false;
+    RailtestReply result;
+
+    railtestCommandAsync(channel, cmd, [&](const RailtestReply &reply)
+    {
+        result = reply;
+        done = true;
+    }, msecs);
+    waitForReply(done);
+
+    return result;
+}
+
+void PortManager::boardCommandAsync(const char *frame, int size, const BoardHandler &handler, int msecs)
+{
+    QMutexLocker locker(&_ioMutex);
+
     if (!_serial.isOpen())
     {
         qCritical() << "Serial is closed:" << _serial.portName();
+        _reply(handler, false);
 
-        return QStringList();
+        return;
     }
 
-    if (frame.size() < (int)sizeof(MB_Packet_t))
-        return QStringList();
+    if (size < (int)sizeof(MB_Packet_t) || size > MAX_BOARD_FRAME)
+    {
+        _reply(handler, false);
 
-    QElapsedTimer stopWatch;
+        return;
+    }
 
-    QCoreApplication::processEvents();
-    _serial.clear();
-    sendFrame(0, frame);
-    for (stopWatch.start(); _restTime(msecs, stopWatch.elapsed()) > 0;)
+    if (_queuedCount == QUEUE_SIZE)
+    {
+        qCritical() << "Measuring board command queue is full:" << _serial.portName();
+        _reply(handler, false);
+
+        return;
+    }
+
+    QueuedCommand &command = _queuedCommands[(_queuedHead + _queuedCount++) % QUEUE_SIZE];
+
+    memcpy(command.frame, frame, size);
+    command.size = size;
+    command.msecs = msecs;
+    command.handler = handler;
+    sendQueuedCommands();
+}
+
+void PortManager::setTimeoutPolicy(double percentile, double margin, int minMsecs, int defaultMsecs, int minSamples)
+{
+    _timeoutPercentile = qBound(50.0, percentile, 100.0);
+    _timeoutMargin = qMax(1.0, margin);
+    _minTimeout = qMax(1, minMsecs);
+    _defaultTimeout = qMax(_minTimeout, defaultMsecs);
+    _minSamples = qMax(1, minSamples);
+}
+
+int PortManager::commandTimeout(const QByteArray &key) const
+{
+    if (_fixedTimeout > 0)
+        return _fixedTimeout;
+
+    auto it = _latency.constFind(key);
+
+    if (it == _latency.constEnd() || it->count() < quint64(_minSamples))
+        return _defaultTimeout;
+
+    qint64 msecs = qint64(it->percentile(_timeoutPercentile) * _timeoutMargin + 999) / 1000;
+
+    return (int)qBound(qint64(_minTimeout), msecs, qint64(_defaultTimeout));
+}
+
+const QByteArray &PortManager::boardKey(quint16 type)
+{
+    auto it = _boardKeys.find(type);
+
+    if (it == _boardKeys.end())
+        it = _boardKeys.insert(type, "mb_" + QByteArray::number(type));
+
+    return it.value();
+}
+
+QByteArray PortManager::railtestKey(const QByteArray &cmd)
+{
+    return "rt_" + cmd.trimmed().split(' ').at(0).toLower();
+}
+
+void PortManager::setWindowSize(int size)
+{
+    _windowSize = qBound(1, size, 255);
+    _windowLimit = _windowSize;
+    _windowCredit = 0;
+}
+
+void PortManager::sendQueuedCommands()
+{
+    while (_queuedCount > 0 && _pendingCount < _windowLimit)
     {
-        QByteArray reply = waitForFrame(_restTime(msecs, stopWatch.elapsed()));
+        QueuedCommand &command = _queuedCommands[_queuedHead];
+        const MB_Packet_t *header = (const MB_Packet_t*)command.frame;
+        PendingCommand &pending = _pendingCommands[header->sequence];
 
-        // Timeout when no reply received.
-        if (reply.isEmpty())
+        // Wait until the previous command with the same sequence number is completed.
+        if (pending.active)
             break;
 
-        int channel;
-        QByteArray message;
+        quint16 type = qFromBigEndian(header->type);
+        int msecs = (AUTO_TIMEOUT == command.msecs) ? commandTimeout(boardKey(type)) : command.msecs;
+
+        pending.active = true;
+        pending.deadline = deadline(msecs);
+        pending.handler.swap(command.handler);
+        pending.type = type;
+        pending.sentAt = now();
+        ++_pendingCount;
+        sendFrame(0, command.frame, command.size);
+        _queuedHead = (_queuedHead + 1) % QUEUE_SIZE;
+        --_queuedCount;
+    }
 
-        if (decodeFrame(reply, channel, message)
-                && 0 == channel
-                && message.size() >= (int)sizeof(MB_GeneralResult_t)
-                && frame.at(2) == message.at(2))
+    restartTimeoutTimer();
+}
+
+void PortManager::railtestCommandAsync(int channel, const QByteArray &cmd, const RailtestHandler &handler, int msecs)
+{
+    QMutexLocker locker(&_ioMutex);
+
+    if (!_serial.isOpen())
+    {
+        qCritical() << "Serial is closed:" << _serial.portName();
+        _reply(handler, RailtestReply());
+
+        return;
+    }
+
+    RailtestChannel *railtest = railtestChannel(channel);
+
+    if (!railtest)
+    {
+        _reply(handler, RailtestReply());
+
+        return;
+    }
+
+    railtest->commands.enqueue({cmd, msecs, -1, handler, railtestKey(cmd), 0});
+    if (railtest->commands.size() == 1)
+        startRailtest(channel);
+}
+
+QList<RailtestReply> PortManager::railtestCommands(const QList<QPair<int, QByteArray>> &commands, int msecs)
+{
+    QMutexLocker locker(&_ioMutex);
+
+    int rest = commands.size();
+    bool done = commands.isEmpty();
+    QVector<RailtestReply> results(commands.size());
+
+    for (int i = 0; i < commands.size(); ++i)
+    {
+        railtestCommandAsync(commands.at(i).first, commands.at(i).second, [&, i](const RailtestReply &reply)
         {
-            const MB_GeneralResult_t *gr = (const MB_GeneralResult_t*)message.constData();
+            results[i] = reply;
+            done = (--rest == 0);
+        }, msecs);
+    }
+    waitForReply(done);
 
-            if (MB_GENERAL_RESULT == qFromBigEndian(gr->header.type))
-            {
-                QCoreApplication::processEvents();
+    return results.toList();
+}
 
-                return QStringList() << QString::number(qFromBigEndian(gr->errorCode));
-            }
+PortManager::RailtestChannel *PortManager::railtestChannel(int channel)
+{
+    if (channel < 1 || channel > RAILTEST_CHANNELS)
+        return nullptr;
+
+    return &_railtestChannels[channel - 1];
+}
+
+void PortManager::startRailtest(int channel)
+{
+    RailtestChannel *railtest = railtestChannel(channel);
+    PendingRailtest &command = railtest->commands.head();
+
+    railtest->engine.expect(command.cmd.trimmed().split(' ').at(0), [this, channel](const RailtestReply &reply)
+    {
+        finishRailtest(channel, reply);
+    });
+    command.deadline = deadline((AUTO_TIMEOUT == command.msecs) ? commandTimeout(command.key) : command.msecs);
+    command.sentAt = now();
+    sendFrame(channel, command.cmd + "\r\n\r\n");
+    restartTimeoutTimer();
+}
+
+void PortManager::finishRailtest(int channel, const RailtestReply &reply)
+{
+    RailtestChannel *railtest = railtestChannel(channel);
+    PendingRailtest command = railtest->commands.dequeue();
+
+    // Timed out and aborted commands are not sampled: a missing DUT must not stretch the timeout.
+    if (reply.isComplete())
+        _latency[command.key].add(now() - command.sentAt);
+
+    if (!railtest->commands.isEmpty())
+        startRailtest(channel);
+
+    restartTimeoutTimer();
+    _reply(command.handler, reply);
+}
+
+void PortManager::onRailtestFrame(int channel, const char *data, int size)
+{
+    RailtestChannel *railtest = railtestChannel(channel);
+
+    if (railtest)
+        railtest->engine.feed(data, size);
+}
+
+void PortManager::onReadyRead()
+{
+    QMutexLocker locker(&_ioMutex);
+
+    // Read straight into the codec receive buffer.
+    while (_serial.bytesAvailable() > 0)
+    {
+        int size;
+        char *buffer = _codec.receiveBuffer(&size);
+        qint64 received = _serial.read(buffer, size);
+
+        if (received <= 0)
+        {
+            if (received < 0)
+                qCritical() << "Serial read() error:" << getSerialError();
+
+            return;
         }
+
+        _stats.bytesIn += received;
+        _capture.write(LinkTrace::Rx, buffer, (int)received);
+        _codec.commit((int)received);
     }
+}
 
-    QCoreApplication::processEvents();
+void PortManager::onTimeout()
+{
+    QMutexLocker locker(&_ioMutex);
 
-    return QStringList();
+    expireCommands();
 }
 
-QStringList PortManager::railtestCommand(int channel, const QByteArray &cmd, int msecs)
+void PortManager::onFrameDecoded(int channel, const char *data, int size)
 {
-    if (!_serial.isOpen())
+    if (0 == channel)
     {
-        qCritical() << "Serial is closed:" << _serial.portName();
+        onBoardFrame(data, size);
 
-        return QStringList();
+        return;
     }
 
-    if (channel < 1 || channel > 3)
-        return QStringList();
+    if (!railtestChannel(channel))
+    {
+        ++_stats.discardedFrames;
 
-    bool startPrefixFound = false;
-    QByteArray startPrefix = "{{(" + cmd.trimmed().split(' ').at(0) + ")}";
-    QString response;
-    QElapsedTimer stopWatch;
+        return;
+    }
 
-    QCoreApplication::processEvents();
-    _serial.clear();
-    sendFrame(channel, cmd + "\r\n\r\n");
-    for (stopWatch.start(); _restTime(msecs, stopWatch.elapsed()) > 0;)
+    onRailtestFrame(channel, data, size);
+}
+
+void PortManager::onBoardFrame(const char *data, int size)
+{
+    if (size < (int)sizeof(MB_Packet_t))
     {
-        QByteArray reply = waitForFrame(_restTime(msecs, stopWatch.elapsed()));
+        ++_stats.discardedFrames;
 
-        // Timeout when no reply received.
-        if (reply.isEmpty())
-            break;
+        return;
+    }
 
-        int ch;
-        QByteArray part;
+    const MB_Packet_t *header = (const MB_Packet_t*)data;
 
-        if (decodeFrame(reply, ch, part) && ch == channel)
+    switch (qFromBigEndian(header->type))
+    {
+        case MB_GENERAL_RESULT:
         {
-            int idx;
+            PendingCommand &pending = _pendingCommands[header->sequence];
+
+            if (size < (int)sizeof(MB_GeneralResult_t) || !pending.active)
+            {
+                ++_stats.discardedFrames;
+
+                return;
+            }
 
-            response += part;
-            if (startPrefixFound)
+            const MB_GeneralResult_t *gr = (const MB_GeneralResult_t*)data;
+            BoardHandler handler;
+
+            handler.swap(pending.handler);
+            pending.active = false;
+            --_pendingCount;
+            _latency[boardKey(pending.type)].add(now() - pending.sentAt);
+
+            // Open the window back step by step after the board queue overflow.
+            if (_windowLimit < _windowSize && ++_windowCredit >= _windowLimit)
+            {
+                ++_windowLimit;
+                _windowCredit = 0;
+            }
+
+            sendQueuedCommands();
+            _reply(handler, true, qFromBigEndian(gr->errorCode));
+            break;
+        }
+
+        case MB_ASYNC_EVENT:
+        {
+            if (size < (int)sizeof(MB_Event_t))
             {
-                idx = response.indexOf("\r\n> ", 0, Qt::CaseInsensitive);
-                if (idx >= 0)
-                {
-                    response = response.left(idx);
-                    break;
-                }
+                ++_stats.discardedFrames;
+
+                return;
             }
-            else
+
+            const MB_Event_t *event = (const MB_Event_t*)data;
+
+            int eventCode = qFromBigEndian(event->eventCode);
+
+            ++_stats.events[eventCode];
+
+            if (MB_EVENT_CMDQUEUE_FULL == eventCode)
             {
-                idx = response.indexOf(startPrefix, 0, Qt::CaseInsensitive);
-                if (idx >= 0)
-                {
-                    startPrefixFound = true;
-                    response = response.mid(idx);
-                }
+                // The board drops the command which has not fit into its queue,
+                // the command itself completes by timeout.
+                qWarning() << "Measuring board command queue is full:" << _serial.portName();
+                _windowLimit = qMax(1, _pendingCount - 1);
+                _windowCredit = 0;
             }
+            else if (MB_EVENT_DUTDBGTX_FULL == eventCode)
+                qWarning() << "Measuring board DUT debug TX buffer is full:" << _serial.portName();
+
+            emit boardEvent(eventCode);
+            break;
         }
+
+        case MB_STARTUP:
+        {
+            // The board has lost the commands in flight, fail them now instead of waiting for timeouts.
+            qWarning() << "Measuring board restarted:" << _serial.portName();
+            abortBoardCommands();
+            _windowLimit = _windowSize;
+            _windowCredit = 0;
+            emit boardStarted();
+            break;
+        }
+
+        default:
+            ++_stats.discardedFrames;
+            break;
     }
+}
 
-    QCoreApplication::processEvents();
+void PortManager::waitForReply(const bool &done)
+{
+    QMutexLocker locker(&_ioMutex);
 
-    return startPrefixFound ?
-          response
-              .replace(QChar('{'), QChar(' '))
-              .replace(QChar('}'), QChar(' '))
-              .replace(QChar('\n'), QChar(' '))
-              .replace(QChar('\r'), QChar(' '))
-              .replace(QChar('>'), QChar(' '))
-              .simplified()
-              .split(' ')
-        : QStringList();
+    while (!done)
+        waitForInput();
 }
 
-void PortManager::sendFrame(int channel, const QByteArray &frame) Q_DECL_NOTHROW
+void PortManager::waitForQueueSpace(int count)
 {
-    QByteArray encodedBuffer;
-    quint16 frameCrc = 0xFFFF;
+    QMutexLocker locker(&_ioMutex);
 
-    // Write UART wake up symbols and SLIP frame start.
-    encodedBuffer.reserve((frame.size() + 3) * 2 + 2);
-    encodedBuffer.append(END_SLIP_OCTET);
+    count = qMin(count, QUEUE_SIZE);
+    if (QUEUE_SIZE - _queuedCount >= count)
+        return;
 
-    // Write escaped channel number.
-    quint8 index = channel ^ (frameCrc >> 8);
+    // The queue drains only when the board gets the frames in flight.
+    bool held = _holdWrites;
 
-    _encodeSymbol(encodedBuffer, channel);
-    frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
+    if (held)
+        releaseWrites();
 
-    // Write escaped frame and calculate CRC.
-    foreach (char ch, frame)
-    {
-        quint8 index = (quint8)ch ^ (frameCrc >> 8);
+    // A full queue means a full window, so a reply or a timeout is always ahead.
+    while (QUEUE_SIZE - _queuedCount < count)
+        waitForInput();
 
-        _encodeSymbol(encodedBuffer, ch);
-        frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
-    }
+    if (held)
+        holdWrites();
+}
 
-    // Write escaped CRC.
-    _encodeSymbol(encodedBuffer, frameCrc >> 8);
-    _encodeSymbol(encodedBuffer, frameCrc & 0xFF);
+void PortManager::waitForInput()
+{
+    int msecs = restTime();
 
-    // Write SLIP frame end.
-    encodedBuffer.append(END_SLIP_OCTET);
+    if (msecs != 0 && _serial.waitForReadyRead(msecs))
+    {
+        onReadyRead();
 
-    // Write encoded frame to serial port.
-    _serial.write(encodedBuffer);
-    _serial.flush();
-    _serial.flush();
+        return;
+    }
+
+    if (_serial.error() != QSerialPort::NoError && _serial.error() != QSerialPort::TimeoutError)
+    {
+        qCritical() << "Serial waitForReadyRead() error:" << getSerialError();
+        abortCommands();
+    }
+    else
+    {
+        _serial.clearError();
+        expireCommands();
+    }
 }
 
-QByteArray PortManager::waitForFrame(int msecs)
+void PortManager::expireCommands()
 {
-    bool started = false;
-    QByteArray frame;
-    QElapsedTimer stopWatch;
+    qint64 now = _clock.elapsed();
+    QVector<BoardHandler> expired = takeBoardCommands(now);
+
+    _stats.timeouts += expired.size();
+    sendQueuedCommands();
+    for (auto & handler : expired)
+        _reply(handler, false);
 
-    for (stopWatch.start(); _restTime(msecs, stopWatch.elapsed()) > 0;)
+    for (int channel = 1; channel <= RAILTEST_CHANNELS; ++channel)
     {
-        // Timeout when no response received.
-        if (!_serial.waitForReadyRead(_restTime(msecs, stopWatch.elapsed())))
-        {
-            if (_serial.error())
-                qCritical() << "Serial waitForReadyRead() error:" << getSerialError();
-            break;
-        }
+        RailtestChannel *railtest = railtestChannel(channel);
 
-        QByteArray buffer = _serial.readAll();
+        if (railtest->commands.isEmpty())
+            continue;
 
-        if (buffer.isEmpty() && _serial.error())
-        {
-            qCritical() << "Serial readAll() error:" << getSerialError();
-            break;
-        }
+        qint64 railtestDeadline = railtest->commands.head().deadline;
 
-        foreach (char ch, buffer)
+        if (railtestDeadline >= 0 && railtestDeadline <= now)
         {
-            if (ch == END_SLIP_OCTET)
-                if (started)
-                {
-                    if (frame.size() >= MIN_FRAME_SIZE)
-                        return frame;                      // Full frame reached.
-
-                    frame.clear();
-                }
-                else
-                {
-                    started = true;
-                    frame.clear();
-                }
-            else
-                if (started)
-                    frame.append(ch);
+            ++_stats.timeouts;
+            finishRailtest(channel, railtest->engine.cancel());
         }
     }
+}
+
+void PortManager::abortCommands()
+{
+    QVector<BoardHandler> commands = takeBoardCommands(-1);
+    QList<PendingRailtest> railtests;
+
+    for (; _queuedCount > 0; --_queuedCount)
+    {
+        commands.append(BoardHandler());
+        commands.last().swap(_queuedCommands[_queuedHead].handler);
+        _queuedHead = (_queuedHead + 1) % QUEUE_SIZE;
+    }
+    for (auto & railtest : _railtestChannels)
+    {
+        railtests.append(railtest.commands);
+        railtest.commands.clear();
+        railtest.engine.cancel();
+    }
+    restartTimeoutTimer();
+
+    for (auto & handler : commands)
+        _reply(handler, false);
 
-    return QByteArray();
+    for (auto & railtest : railtests)
+        _reply(railtest.handler, RailtestReply());
 }
 
-bool PortManager::decodeFrame(const QByteArray &frame, int &channel, QByteArray &message)
+void PortManager::abortBoardCommands()
 {
-    QByteArray decodedBuffer;
+    QVector<BoardHandler> commands = takeBoardCommands(-1);
 
-    // Write unescaped buffer.
-    decodedBuffer.reserve(frame.size());
-    for (int i = 0; i < frame.size(); ++i)
+    sendQueuedCommands();
+
+    for (auto & handler : commands)
+        _reply(handler, false);
+}
+
+QVector<PortManager::BoardHandler> PortManager::takeBoardCommands(qint64 expiredAt)
+{
+    QVector<BoardHandler> handlers;
+
+    for (int i = 0; i < 256 && _pendingCount > 0; ++i)
     {
-        char ch = frame.at(i);
+        PendingCommand &pending = _pendingCommands[i];
 
-        if (ch == ESC_SLIP_OCTET)
-        {
-            ++i;
-            if (i >= frame.size())
-            {
-                qWarning() << "SLIP. Decode frame. Unfinished escape sequence.";
+        if (!pending.active || (expiredAt >= 0 && (pending.deadline < 0 || pending.deadline > expiredAt)))
+            continue;
 
-                return false;
-            }
-            switch (frame.at(i))
-            {
-                case END_SUBS_OCTET:
-                    decodedBuffer.append(END_SLIP_OCTET);
-                    break;
+        handlers.append(BoardHandler());
+        handlers.last().swap(pending.handler);
+        pending.active = false;
+        --_pendingCount;
+    }
 
-                case ESC_SUBS_OCTET:
-                    decodedBuffer.append(ESC_SLIP_OCTET);
-                    break;
+    return handlers;
+}
 
-                default:
-                    qWarning() << "SLIP. Decode frame. Invalid escape sequence.";
+void PortManager::restartTimeoutTimer()
+{
+    // The timer serves the event loop of the owner thread only,
+    // blocking waits check deadlines by themselves.
+    if (QThread::currentThread() != thread())
+        return;
 
-                    return false;
-            }
-        }
-        else
-            decodedBuffer.append(ch);
+    int msecs = restTime();
+
+    if (msecs < 0)
+        _timeoutTimer.stop();
+    else
+        _timeoutTimer.start(msecs);
+}
+
+qint64 PortManager::deadline(int msecs) const
+{
+    return msecs < 0 ? -1 : _clock.elapsed() + msecs;
+}
+
+int PortManager::restTime() const
+{
+    qint64 next = -1;
+
+    for (int i = 0; i < 256 && _pendingCount > 0; ++i)
+    {
+        const PendingCommand &command = _pendingCommands[i];
+
+        if (command.active && command.deadline >= 0 && (next < 0 || command.deadline < next))
+            next = command.deadline;
     }
-    if (decodedBuffer.size() < MIN_FRAME_SIZE)
+
+    for (auto & railtest : _railtestChannels)
     {
-        qWarning() << "SLIP. Decode frame. Frame too short.";
+        if (railtest.commands.isEmpty())
+            continue;
 
-        return false;
+        qint64 railtestDeadline = railtest.commands.head().deadline;
+
+        if (railtestDeadline >= 0 && (next < 0 || railtestDeadline < next))
+            next = railtestDeadline;
     }
 
-    // Calculate CRC.
-    int frameSize = decodedBuffer.size() - 2;
-    quint16
-        frameCrc = 0xFFFF,
-        bufferCrc = (quint8)decodedBuffer.at(frameSize + 1) | ((quint16)decodedBuffer.at(frameSize) << 8);
+    if (next < 0)
+        return -1;
+
+    next -= _clock.elapsed();
+
+    return next < 0 ? 0 : (int)next;
+}
+
+void PortManager::sendFrame(int channel, const char *data, int size) Q_DECL_NOTHROW
+{
+    size = _codec.encode(channel, data, size);
+    _stats.bytesOut += size;
+    ++_stats.framesOut;
 
-    for (int i = 0; i < frameSize; ++i)
+    if (_holdWrites)
     {
-        quint8 index = (quint8)decodedBuffer.at(i) ^ (frameCrc >> 8);
+        _heldData.append(_codec.encodedData(), size);
 
-        frameCrc = _crc_ccitt_lut[index] ^ (frameCrc << 8);
+        return;
     }
 
-    // Check CRC.
-    if (frameCrc != bufferCrc)
+    // Write encoded frame to serial port.
+    _serial.write(_codec.encodedData(), size);
+    _serial.flush();
+    _capture.write(LinkTrace::Tx, _codec.encodedData(), size);
+}
+
+bool PortManager::tryBoardCommand(const char *frame, int size, qint32 *result, int msecs)
+{
+    if (!_ioMutex.tryLock())
+        return false;
+
+    bool replied = !_holdWrites && _serial.isOpen() && boardCommand(frame, size, result, msecs);
+
+    _ioMutex.unlock();
+
+    return replied;
+}
+
+void PortManager::holdWrites()
+{
+    QMutexLocker locker(&_ioMutex);
+
+    _holdWrites = true;
+}
+
+void PortManager::releaseWrites()
+{
+    QMutexLocker locker(&_ioMutex);
+
+    _holdWrites = false;
+
+    if (_heldData.isEmpty())
+        return;
+
+    _serial.write(_heldData);
+    _serial.flush();
+    _capture.write(LinkTrace::Tx, _heldData.constData(), _heldData.size());
+    _heldData.resize(0);                        // Keeps the capacity for the next batch
+}
+
+bool PortManager::replay(const QString &path, bool realTime)
+{
+    if (_serial.isOpen())
     {
-        qWarning() << "SLIP. Decode frame. Invalid Frame CRC.";
+        qCritical() << "Cannot replay a link trace into the open port:" << _serial.portName();
 
         return false;
     }
 
-    // Frame received successfully.
-    channel = decodedBuffer.at(0);
-    message = decodedBuffer.mid(1, frameSize - 1);
+    LinkTraceReader trace;
+
+    if (!trace.open(path))
+        return false;
+
+    LinkTraceReader::Record record;
+    QElapsedTimer clock;
+
+    _codec.reset();
+    clock.start();
+    while (trace.next(&record))
+    {
+        if (LinkTrace::Tx == record.direction)
+            continue;
+
+        if (realTime)
+        {
+            qint64 rest = record.usecs - clock.nsecsElapsed() / 1000;
+
+            if (rest > 0)
+                QThread::usleep((unsigned long)rest);
+        }
+
+        _stats.bytesIn += record.size;
+        _codec.feed(record.data, record.size);
+    }
+    _codec.reset();
 
     return true;
 }
 
+PortManager::LinkStats PortManager::linkStats() const
+{
+    LinkStats stats = _stats;
+    const SlipCodec::Stats &codec = _codec.stats();
+
+    stats.framesIn = codec.frames;
+    stats.crcErrors = codec.crcErrors;
+    stats.escapeErrors = codec.escapeErrors;
+    stats.shortFrames = codec.shortFrames;
+    stats.longFrames = codec.longFrames;
+
+    return stats;
+}
+
+void PortManager::resetLinkStats()
+{
+    _stats = LinkStats();
+    _codec.resetStats();
+}
+
+QString PortManager::eventName(int eventCode)
+{
+    switch (eventCode)
+    {
+        case MB_EVENT_SLIP_ERROR:
+            return "slipError";
+        case MB_EVENT_COMMAND_TOO_LONG:
+            return "commandTooLong";
+        case MB_EVENT_CMDQUEUE_FULL:
+            return "cmdQueueFull";
+        case MB_EVENT_DUTDBGTX_FULL:
+            return "dutDbgTxFull";
+        case MB_EVENT_INVALID_CHANNEL:
+            return "invalidChannel";
+        default:
+            return QString("event%1").arg(eventCode);
+    }
+}
+
 QString PortManager::getSerialError()
 {
     QString ret = _serial.portName() + " " + _serial.errorString() + " (" + _serial.error() + ")";
@@ -2,9 +2,21 @@
 #define PORTMANAGER_H
 
 #include <QSerialPort>
+#include <QElapsedTimer>
+#include <QTimer>
+#include <QQueue>
+#include <QHash>
+#include <QMap>
+#include <QVector>
+#include <QMutex>
+
+#include <functional>
 
 #include "SlipProtocol.h"
-#include "Logger.h"
+#include "SlipCodec.h"
+#include "RailtestEngine.h"
+#include "LatencyHistogram.h"
+#include "LinkTrace.h"
 
 class PortManager : public QObject
 {
@@ -12,6 +24,39 @@ class PortManager : public QObject
 
 public:
 
+    // Called once per board command: with the MB_GENERAL_RESULT code, or with replied = false on timeout.
+    typedef std::function<void(bool replied, qint32 result)> BoardHandler;
+
+    // Called once per railtest command: with the parsed reply or with an invalid one on timeout.
+    typedef std::function<void(const RailtestReply &reply)> RailtestHandler;
+
+    // Timeout of the commands sent without an explicit one: the fixed timeout when set, otherwise
+    // derived from the latency histogram of the command type (percentile x margin), or the default
+    // one until the histogram collects enough samples.
+    static constexpr int AUTO_TIMEOUT = -2;
+
+    // Board command frames are kept in place, the board drops longer ones anyway.
+    static constexpr int MAX_BOARD_FRAME = 64;
+
+    // Commands waiting for a free window slot, more fail at once.
+    static constexpr int QUEUE_SIZE = 256;
+
+    // Link counters since open() or resetLinkStats().
+    struct LinkStats
+    {
+        quint64 bytesIn = 0;
+        quint64 bytesOut = 0;
+        quint64 framesIn = 0;
+        quint64 framesOut = 0;
+        quint64 crcErrors = 0;
+        quint64 escapeErrors = 0;
+        quint64 shortFrames = 0;
+        quint64 longFrames = 0;
+        quint64 timeouts = 0;
+        quint64 discardedFrames = 0;            // Unknown channel or type, late replies
+        QMap<int, quint64> events;              // MB_ASYNC_EVENT code -> count
+    };
+
     explicit PortManager(QObject *parent = nullptr);
 
     void setPort(const QString &name,
@@ -21,21 +66,171 @@ public:
                  QSerialPort::StopBits stopBits = QSerialPort::OneStop,
                  QSerialPort::FlowControl flowControl = QSerialPort::NoFlowControl);
 
-    QStringList slipCommand(const QByteArray &frame, int msecs = 5000);
-    QStringList railtestCommand(int channel, const QByteArray &cmd, int msecs = 5000);
+    // Blocking wrappers over the asynchronous commands.
+    bool boardCommand(const char *frame, int size, qint32 *result, int msecs = AUTO_TIMEOUT);
+    QStringList railtestCommand(int channel, const QByteArray &cmd, int msecs = AUTO_TIMEOUT);
+    RailtestReply railtestReply(int channel, const QByteArray &cmd, int msecs = AUTO_TIMEOUT);
+
+    // Non-blocking commands. The handler is called from readyRead() processing
+    // when the reply frame arrives or from the timeout timer.
+    // The frame is copied, see BoardCommands.h for the frame layouts. Fails at once when
+    // QUEUE_SIZE commands are waiting already.
+    void boardCommandAsync(const char *frame, int size, const BoardHandler &handler, int msecs = AUTO_TIMEOUT);
+    void railtestCommandAsync(int channel, const QByteArray &cmd, const RailtestHandler &handler, int msecs = AUTO_TIMEOUT);
+
+    // Sends railtest commands to several DUT channels at once and waits for every reply.
+    QList<RailtestReply> railtestCommands(const QList<QPair<int, QByteArray>> &commands, int msecs = AUTO_TIMEOUT);
+
+    // Waits until the flag is set by a handler of the asynchronous commands.
+    void waitForReply(const bool &done);
+
+    // Waits until count more commands fit into the queue. Held writes go out meanwhile,
+    // the hold is restored afterwards. Longer bursts call it before every command.
+    void waitForQueueSpace(int count = 1);
+
+    // Background variant of boardCommand() for another thread: gives way to the foreground
+    // commands and returns false at once while the port is in use or the writes are held.
+    bool tryBoardCommand(const char *frame, int size, qint32 *result, int msecs = AUTO_TIMEOUT);
+
+    // While held, the frames sent are collected and go to the port in one write on release.
+    void holdWrites();
+    void releaseWrites();
+
+    // Maximum number of measuring board commands in flight.
+    void setWindowSize(int size);
+    int windowSize() const {return _windowSize;}
+
+    // Fixed timeout for AUTO_TIMEOUT commands, 0 - adaptive.
+    void setTimeout(int msecs) {_fixedTimeout = qMax(0, msecs);}
+    int timeout() const {return _fixedTimeout;}
+
+    void setTimeoutPolicy(double percentile, double margin, int minMsecs, int defaultMsecs, int minSamples);
+    int commandTimeout(const QByteArray &key) const;
+
+    // Reply latency per command type. Keys: "mb_<packet type>" and "rt_<railtest command>".
+    const QHash<QByteArray, LatencyHistogram> &latencyHistograms() const {return _latency;}
+    void setLatencyHistogram(const QByteArray &key, const LatencyHistogram &histogram) {_latency.insert(key, histogram);}
+
+    LinkStats linkStats() const;
+    void resetLinkStats();
+
+    QString portName() const {return _serial.portName();}
+
+    // Records the raw link data in both directions into a trace file, see LinkTrace.h.
+    bool startCapture(const QString &path) {return _capture.open(path);}
+    void stopCapture() {_capture.close();}
+    bool isCapturing() const {return _capture.isOpen();}
+
+    // Feeds the received data of a trace through the decoder as if it came from the port,
+    // at full speed or keeping the recorded timing. The port must be closed.
+    bool replay(const QString &path, bool realTime = false);
+    static QString eventName(int eventCode);
 
 public slots:
 
     bool open();
     void close();
 
+signals:
+
+    // Board-initiated frames. Emitted while decoding the received data,
+    // so directly connected slots must not run blocking commands.
+    void boardStarted();
+    void boardEvent(int eventCode);
+
+private slots:
+
+    void onReadyRead();
+    void onTimeout();
+
 private:
 
+    struct PendingCommand
+    {
+        bool active = false;
+        qint64 deadline = -1;
+        BoardHandler handler;
+        quint16 type = 0;                       // Latency histogram
+        qint64 sentAt = 0;                      // usecs
+    };
+
+    struct QueuedCommand
+    {
+        char frame[MAX_BOARD_FRAME];
+        int size;
+        int msecs;
+        BoardHandler handler;
+    };
+
+    struct PendingRailtest
+    {
+        QByteArray cmd;
+        int msecs;
+        qint64 deadline;
+        RailtestHandler handler;
+        QByteArray key;
+        qint64 sentAt;
+    };
+
+    // Demultiplexed DUT debug UART, SLIP channels 1..3.
+    // Replies carry no sequence number, so commands on one channel go one by one.
+    struct RailtestChannel
+    {
+        QQueue<PendingRailtest> commands;       // Head is in flight
+        RailtestEngine engine;
+    };
+
+    static constexpr int RAILTEST_CHANNELS = 3;
+
+    QMutex _ioMutex;                                // Recursive, serializes the port users
     QSerialPort _serial;
+    SlipCodec _codec;
+    QElapsedTimer _clock;
+    QTimer _timeoutTimer;
+
+    PendingCommand _pendingCommands[256];           // Index is MB_Packet_t sequence
+    int _pendingCount = 0;
+    QueuedCommand _queuedCommands[QUEUE_SIZE];      // Ring of the commands waiting for a free window slot
+    int _queuedHead = 0;
+    int _queuedCount = 0;
+    int _windowSize = 1;
+    int _windowLimit = 1;                           // Reduced on MB_EVENT_CMDQUEUE_FULL
+    int _windowCredit = 0;
+    RailtestChannel _railtestChannels[RAILTEST_CHANNELS];
+
+    QHash<QByteArray, LatencyHistogram> _latency;
+    QHash<quint16, QByteArray> _boardKeys;
+    LinkStats _stats;
+    LinkTraceWriter _capture;
+    bool _holdWrites = false;
+    QByteArray _heldData;
+    int _fixedTimeout = 0;
+    double _timeoutPercentile = 99.9;
+    double _timeoutMargin = 3.0;
+    int _minTimeout = 50;
+    int _defaultTimeout = 5000;
+    int _minSamples = 30;
 
-    void sendFrame(int channel, const QByteArray &frame) Q_DECL_NOTHROW;
-    QByteArray waitForFrame(int msecs);
-    static bool decodeFrame(const QByteArray &frame, int &channel, QByteArray &message);
+    void sendFrame(int channel, const char *data, int size) Q_DECL_NOTHROW;
+    void sendFrame(int channel, const QByteArray &frame) Q_DECL_NOTHROW {sendFrame(channel, frame.constData(), frame.size());}
+    void onFrameDecoded(int channel, const char *data, int size);
+    void onBoardFrame(const char *data, int size);
+    void sendQueuedCommands();
+    RailtestChannel *railtestChannel(int channel);
+    void onRailtestFrame(int channel, const char *data, int size);
+    void startRailtest(int channel);
+    void finishRailtest(int channel, const RailtestReply &reply);
+    void waitForInput();
+    void expireCommands();
+    void abortCommands();
+    void abortBoardCommands();
+    QVector<BoardHandler> takeBoardCommands(qint64 expiredAt);     // All of them for expiredAt < 0
+    void restartTimeoutTimer();
+    qint64 deadline(int msecs) const;
+    int restTime() const;
+    qint64 now() const {return _clock.nsecsElapsed() / 1000;}
+    const QByteArray &boardKey(quint16 type);
+    static QByteArray railtestKey(const QByteArray &cmd);
     QString getSerialError();
 };
 
@@ -2,18 +2,76 @@ const SLOTS_NUMBER = 3;
 var jlinkList = [];
 var testClientList = [];
 
+// Timer based, the event loop keeps running while the script waits.
 function delay(milliseconds)
 {
-    const date = Date.now();
-    let currentDate = null;
-
-    do {
-        currentDate = Date.now();
-     } while (currentDate - date < milliseconds);
+    station.sleep(milliseconds);
 }
 
 GeneralCommands =
 {
+    // Sends the command lists to all measuring boards at once. commandsOf(testClient, i) returns
+    // the board commands, e.g. [["readAIN", 1, 4, 0], ...]. Returns the results per board,
+    // in the testClientList order, null for the disconnected boards.
+    stationBatch: function (commandsOf)
+    {
+        let results = [];
+
+        for (let i = 0; i < testClientList.length; i++)
+        {
+            if (testClientList[i].isConnected())
+                testClientList[i].startBatch(commandsOf(testClientList[i], i));
+        }
+
+        for (let i = 0; i < testClientList.length; i++)
+            results.push(testClientList[i].isConnected() ? testClientList[i].finishBatch() : null);
+
+        return results;
+    },
+
+    //---
+
+    // Burst form of stationBatch: every command is sent n times, the results are the
+    // statistics {count, failed, min, max, mean, stddev, median} per command.
+    stationSamples: function (commandsOf, n)
+    {
+        let results = [];
+
+        for (let i = 0; i < testClientList.length; i++)
+        {
+            if (testClientList[i].isConnected())
+                testClientList[i].startSampleBatch(commandsOf(testClientList[i], i), n);
+        }
+
+        for (let i = 0; i < testClientList.length; i++)
+            results.push(testClientList[i].isConnected() ? testClientList[i].finishSampleBatch() : null);
+
+        return results;
+    },
+
+    //---
+
+    // Tags the background power samples of all boards with the test step.
+    setPowerStep: function (step)
+    {
+        for (let i = 0; i < testClientList.length; i++)
+            testClientList[i].setPowerStep(step);
+    },
+
+    //---
+
+    // Stores the energy and peak current figures of the cycle to the DUTs.
+    finishPowerProfiles: function ()
+    {
+        for (let i = 0; i < testClientList.length; i++)
+        {
+            if (testClientList[i].isConnected())
+                testClientList[i].finishPowerProfile();
+        }
+    },
+
+    //---
+
     isMethodCorrect: false,
 
     testConnection: function ()
@@ -57,6 +115,7 @@ GeneralCommands =
 
     unlockAndEraseChip: function ()
     {
+        GeneralCommands.setPowerStep("erase");
         for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
             for (var i = 0; i < testClientList.length; i++)
@@ -110,6 +169,7 @@ GeneralCommands =
 
     downloadRailtest: function (dummyFileName, railtestFileName)
     {
+        GeneralCommands.setPowerStep("railtest");
         actionHintWidget.showProgressHint("Downloading the Railtest...");
 
         for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
@@ -187,6 +247,7 @@ GeneralCommands =
 
     downloadSoftware: function (softwareFileName)
     {
+        GeneralCommands.setPowerStep("software");
         logger.logInfo("Software downloading started");
         actionHintWidget.showProgressHint("Downloading the software...");
 
@@ -308,8 +369,11 @@ GeneralCommands =
             let testClient = testClientList[i];
             if(testClient.isConnected())
             {
-                logger.logInfo("Measuring board " + testClient.no() + " current: " + testClient.readCSA(0) + " mA");
-                logger.logDebug("Measuring board " + testClient.no() + " current: " + testClient.readCSA(0) + " mA");
+                let current = testClient.sampleCSA(0, 8);
+
+                logger.logInfo("Measuring board " + testClient.no() + " current: " + current.median + " mA");
+                logger.logDebug("Measuring board " + testClient.no() + " current: " + current.median + " mA, min " + current.min +
+                                ", max " + current.max + ", stddev " + current.stddev + ", failed " + current.failed);
             }
         }
     },
@@ -318,45 +382,44 @@ GeneralCommands =
 
     powerOn: function ()
     {
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        GeneralCommands.stationBatch(function (testClient)
         {
-            for (var i = 0; i < testClientList.length; i++)
-            {
-                let testClient = testClientList[i];
-                if(!testClient.isConnected())
-                    continue;
+            let commands = [];
 
+            for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    testClient.powerOn(slot);
+                    commands.push(["powerOn", slot]);
                     logger.logInfo("DUT " + testClient.dutNo(slot) + " is switched ON");
                     logger.logDebug("DUT " + testClient.dutNo(slot) + " is switched ON");
                 }
             }
-        }
+
+            return commands;
+        });
     },
 
     //---
 
     powerOff: function ()
     {
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        GeneralCommands.stationBatch(function (testClient)
         {
-            for (var i = 0; i < testClientList.length; i++)
-            {
-                let testClient = testClientList[i];
-                if(!testClient.isConnected())
-                    continue;
+            let commands = [];
 
+            for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    let testClient = testClientList[i];
-                    testClient.powerOff(slot);
+                    commands.push(["powerOff", slot]);
                     logger.logInfo("DUT " + testClient.dutNo(slot) + " is switched OFF");
                     logger.logDebug("DUT " + testClient.dutNo(slot) + " is switched OFF");
                 }
             }
-        }
+
+            return commands;
+        });
     },
 
     //---
@@ -390,31 +453,81 @@ GeneralCommands =
 
     //---
 
+    checkedSlots: function (testClient)
+    {
+        let slots = [];
+
+        for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        {
+            if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
+                slots.push(slot);
+        }
+
+        return slots;
+    },
+
+    //---
+
+    negotiateDutDebug: function ()
+    {
+        actionHintWidget.showProgressHint("Negotiating DUT debug UART speed...");
+
+        for (let i = 0; i < testClientList.length; i++)
+        {
+            let testClient = testClientList[i];
+            let slots = GeneralCommands.checkedSlots(testClient);
+
+            for (let k = 0; k < slots.length; k++)
+            {
+                let baudRate = testClient.negotiateDutDebug(slots[k]);
+                logger.logDebug("Debug UART speed for DUT " + testClient.dutNo(slots[k]) + ": " + baudRate + " baud");
+            }
+        }
+
+        actionHintWidget.showProgressHint("READY");
+    },
+
+    //---
+
     readChipId: function ()
     {
         actionHintWidget.showProgressHint("Reading device's IDs...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        for (let i = 0; i < testClientList.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
+            let testClient = testClientList[i];
+            let slots = GeneralCommands.checkedSlots(testClient);
+            let replies = testClient.railtestCommands(slots, "getmemw 0x0FE081F0 2");
+
+            for (let k = 0; k < slots.length; k++)
             {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
+                let slot = slots[k];
+                let reply = replies[k];
+
+                // Low word, then high word as {address}{value} pairs: all in one record
+                // ({{(getmemw)}{a0}{v0}{a1}{v1}}) or one pair per record
+                let words = [];
+
+                for (let r = 0; r < reply.records.length; r++)
                 {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "getmemw 0x0FE081F0 2");
-                    if(response.length > 4)
-                    {
-                        let id = response[response.length - 1].slice(2) + response[response.length - 3].slice(2);
-                        testClient.setDutProperty(slot, "id", id.toUpperCase());
-                        logger.logSuccess("ID for DUT " + testClient.dutNo(slot) + " has been read: " + testClient.dutProperty(slot, "id"));
-                        logger.logDebug("ID for DUT " + testClient.dutNo(slot) + ": " + testClient.dutProperty(slot, "id"));
-                    }
+                    let values = reply.records[r].values;
 
-                    else
-                    {
-                       logger.logError("Couldn't read ID for DUT " + testClient.dutNo(slot));
-                       logger.logDebug("Couldn't read ID for DUT " + testClient.dutNo(slot));
-                    }
+                    for (let v = 1; v < values.length; v += 2)
+                        words.push(values[v]);
+                }
+
+                if(words.length > 1)
+                {
+                    let id = words[1].slice(2) + words[0].slice(2);
+                    testClient.setDutProperty(slot, "id", id.toUpperCase());
+                    logger.logSuccess("ID for DUT " + testClient.dutNo(slot) + " has been read: " + testClient.dutProperty(slot, "id"));
+                    logger.logDebug("ID for DUT " + testClient.dutNo(slot) + ": " + testClient.dutProperty(slot, "id"));
+                }
+
+                else
+                {
+                   logger.logError("Couldn't read ID for DUT " + testClient.dutNo(slot));
+                   logger.logDebug("Couldn't read ID for DUT " + testClient.dutNo(slot));
                 }
             }
         }
@@ -435,10 +548,10 @@ GeneralCommands =
                 if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
                 {
                     let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "rtc");
+                    let reply = testClient.railtestReply(slot, "rtc");
 
                     logger.logInfo("Current RTC value for DUT " + testClient.dutNo(slot) + " has been read.");
-                    logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + response.slice(7));
+                    logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + JSON.stringify(reply.fields));
                 }
             }
         }
@@ -452,63 +565,51 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Testing Accelerometer...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        for (let i = 0; i < testClientList.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
+            let testClient = testClientList[i];
+            let slots = GeneralCommands.checkedSlots(testClient);
+            let replies = testClient.railtestCommands(slots, "accl");
+
+            for (let k = 0; k < slots.length; k++)
             {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
+                let slot = slots[k];
+                let reply = replies[k];
+
+                if(!reply.valid)
                 {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "accl");
-                    let patternFound = false;
+                    testClient.setDutProperty(slot, "accelChecked", false);
+                    testClient.addDutError(slot, "Accelerometer: no response");
+                    logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
+                    logger.logDebug("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
+                }
+
+                else if(typeof reply.fields.X !== "number" || typeof reply.fields.Y !== "number" || typeof reply.fields.Z !== "number")
+                {
+                    testClient.setDutProperty(slot, "accelChecked", false);
+                    testClient.addDutError(slot, reply.text);
+                    logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". Invalid response recieved.");
+                    logger.logDebug("Accelerometer failure. Invalid response: " + reply.text);
+                }
+
+                else
+                {
+                    let x = reply.fields.X;
+                    let y = reply.fields.Y;
+                    let z = reply.fields.Z;
 
-                    if(response.length < 3)
+                    if (x > 10 || x < -10 || y > 10 || y < -10 || z < -90 || z > 100)
                     {
                         testClient.setDutProperty(slot, "accelChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
-                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
-                        logger.logDebug("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". No response recieved.");
+                        testClient.addDutError(slot, reply.text);
+                        logger.logDebug("Accelerometer failure for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z + ".");
+                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot));
                     }
-
                     else
                     {
-                        for (let j = 0; j < response.length; j++)
-                        {
-                            if((j + 2) < response.length)
-                            {
-                                if (response[j].includes("X") && response[j + 1].includes("Y") && response[j + 2].includes("Z"))
-                                {
-                                    patternFound = true;
-                                    let x = Number(response[j].slice(2, 5));
-                                    let y = Number(response[j + 1].slice(2, 5));
-                                    let z = Number(response[j + 2].slice(2, 5));
-
-                                    if (x > 10 || x < -10 || y > 10 || y < -10 || z < -90 || z > 100)
-                                    {
-                                        testClient.setDutProperty(slot, "accelChecked", false);
-                                        testClient.addDutError(slot, response.join(' '));
-                                        logger.logDebug("Accelerometer failure for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z + ".");
-                                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot));
-                                    }
-                                    else
-                                    {
-                                        testClient.setDutProperty(slot, "accelChecked", true);
-                                        logger.logSuccess("Accelerometer for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                                        logger.logDebug("Accelerometer values for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z);
-                                    }
-
-                                    break;
-                                }
-                            }
-                        }
-                    }
-
-                    if(!patternFound)
-                    {
-                        testClient.setDutProperty(slot, "accelChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
-                        logger.logError("Accelerometer failture for DUT " + testClient.dutNo(slot) + ". Invalid response recieved.");
-                        logger.logDebug("Accelerometer failure. Invalid response: " + response);
+                        testClient.setDutProperty(slot, "accelChecked", true);
+                        logger.logSuccess("Accelerometer for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+                        logger.logDebug("Accelerometer values for DUT " + testClient.dutNo(slot) + "; X=" + x +", Y=" + y + ", Z=" + z);
                     }
                 }
             }
@@ -523,46 +624,41 @@ GeneralCommands =
     {
         actionHintWidget.showProgressHint("Testing light sensor...");
 
-        for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        for (let i = 0; i < testClientList.length; i++)
         {
-            for (let i = 0; i < testClientList.length; i++)
-            {
-                if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
-                {
-                    let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "lsen");
-                    let patternFound = false;
+            let testClient = testClientList[i];
+            let slots = GeneralCommands.checkedSlots(testClient);
+            let replies = testClient.railtestCommands(slots, "lsen");
 
-                    if(response.length > 1)
-                    {
-                        if (response[1].includes("opwr"))
-                        {
-                            patternFound = true;
-                            let x = Number(response[1].slice(5, 5));
+            for (let k = 0; k < slots.length; k++)
+            {
+                let slot = slots[k];
+                let reply = replies[k];
 
-                            if (x < 0)
-                            {
-                                testClientList.setDutProperty(slot, "lightSensChecked", false);
-                                testClientList.addDutError(slot, response.join(' '));
-                                logger.logDebug("Light sensor failure: OPWR=" + x  + ".");
-                                logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
-                            }
-                            else
-                            {
-                                testClient.setDutProperty(slot, "lightSensChecked", true);
-                                logger.logSuccess("Light sensor for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
-                                logger.logDebug("Light sensor value: OPWR=" + x);
-                            }
-                        }
-                    }
+                if (typeof reply.fields.opwr === "number")
+                {
+                    let x = reply.fields.opwr;
 
-                    if(!patternFound)
+                    if (x < 0)
                     {
                         testClient.setDutProperty(slot, "lightSensChecked", false);
-                        testClient.addDutError(slot, response.join(' '));
+                        testClient.addDutError(slot, reply.text);
+                        logger.logDebug("Light sensor failure: OPWR=" + x  + ".");
                         logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
-                        logger.logDebug("Light sensor failture for DUT " + testClient.dutNo(slot) + ": " + response.join(' '));
                     }
+                    else
+                    {
+                        testClient.setDutProperty(slot, "lightSensChecked", true);
+                        logger.logSuccess("Light sensor for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
+                        logger.logDebug("Light sensor value: OPWR=" + x);
+                    }
+                }
+                else
+                {
+                    testClient.setDutProperty(slot, "lightSensChecked", false);
+                    testClient.addDutError(slot, reply.text);
+                    logger.logError("Light sensor failture for DUT " + testClient.dutNo(slot));
+                    logger.logDebug("Light sensor failture for DUT " + testClient.dutNo(slot) + ": " + reply.text);
                 }
             }
         }
@@ -572,10 +668,14 @@ GeneralCommands =
 
     //---
 
+    // RfModuleId and channel may be lists: the DUTs are then spread over the reference
+    // modules, each module on its own channel, see RadioScheduler.
     testRadio: function (RfModuleId, channel, powerTable, minRSSI, maxRSSI, count)
     {
         actionHintWidget.showProgressHint("Testing radio interface...");
 
+        let jobs = [];
+
         for(let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
             for (let i = 0; i < testClientList.length; i++)
@@ -583,17 +683,15 @@ GeneralCommands =
                 if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
                 {
                     logger.logDebug("Radio testing for DUT " + testClientList[i].dutNo(slot) + " with power value: " + powerTable[testClientList[i].dutNo(slot) - 1]);
-                    for (let j = 0; j < 3; j++)
-                    {
-                        if (testClientList[i].dutProperty(slot, "radioChecked"))
-                            break;
-
-                        testClientList[i].testRadio(slot, RfModuleId, channel, powerTable[testClientList[i].dutNo(slot) - 1], minRSSI, maxRSSI, count);
-                    }
+                    jobs.push({testClient: testClientList[i], slot: slot, power: powerTable[testClientList[i].dutNo(slot) - 1]});
                 }
             }
         }
 
+        radioScheduler.run(Array.isArray(RfModuleId) ? RfModuleId : [RfModuleId],
+                           Array.isArray(channel) ? channel : [channel],
+                           jobs, minRSSI, maxRSSI, count, 3);
+
         actionHintWidget.showProgressHint("READY");
     },
 
@@ -618,12 +716,12 @@ GeneralCommands =
                 {
                     let testClient = testClientList[i];
                     let daliOk = false;
-                    let responseString = "";
+                    let reply = {};
 
-                    for (j = 0; j < 3; j++)
+                    for (let j = 0; j < 3; j++)
                     {
-                        responseString = testClient.railtestCommand(slot, "dali 0xFF90 16 0 250000").join(' ');
-                        if (responseString.includes("error:0") && responseString.includes("reply_bits:8"))
+                        reply = testClient.railtestReply(slot, "dali 0xFF90 16 0 250000");
+                        if (reply.fields.error === 0 && reply.fields.reply_bits === 8)
                         {
                             daliOk = true;
                             break;
@@ -638,9 +736,9 @@ GeneralCommands =
                     else
                     {
                         testClient.setDutProperty(slot, "daliChecked", false);
-                        testClient.addDutError(slot, responseString);
+                        testClient.addDutError(slot, reply.text);
                         logger.logError("DALI testing for DUT " + testClient.dutNo(slot) + " has been failed.");
-                        logger.logDebug("DALI failure for DUT " + testClient.dutNo(slot) + ": " + responseString);
+                        logger.logDebug("DALI failure for DUT " + testClient.dutNo(slot) + ": " + reply.text);
                     }
                 }
             }
@@ -669,8 +767,8 @@ GeneralCommands =
                 if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
                 {
                     let testClient = testClientList[i];
-                    let responseString = testClient.railtestCommand(slot, "gnrx 3").join(' ');
-                    if (responseString.includes("line"))
+                    let reply = testClient.railtestReply(slot, "gnrx 3");
+                    if (reply.fields.line !== undefined)
                     {
                         testClient.setDutProperty(slot, "gnssChecked", true);
                         logger.logSuccess("GNSS module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
@@ -680,8 +778,8 @@ GeneralCommands =
                     else
                     {
                         testClient.setDutProperty(slot, "gnssChecked", false);
-                        testClient.addDutError(slot, responseString);
-                        logger.logDebug("GNSS module failture: " + responseString);
+                        testClient.addDutError(slot, reply.text);
+                        logger.logDebug("GNSS module failture: " + reply.text);
                         logger.logError("GNSS module failture for DUT " + testClient.dutNo(slot));
 
                     }
@@ -117,32 +117,62 @@ NemaPP =
         NemaPP.powerOn();
         delay(1000);
 
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
-            for (i = 0; i < testClientList.length; i++)
+            for (let i = 0; i < testClientList.length; i++)
             {
-                var testClient = testClientList[i];
-
-                if(!testClient.isConnected())
+                if(!testClientList[i].isConnected())
                     continue;
 
-                testClient.setDutProperty(slot, "state", 0);
-                testClient.setDutProperty(slot, "checked", false);
+                testClientList[i].setDutProperty(slot, "state", 0);
+                testClientList[i].setDutProperty(slot, "checked", false);
+            }
+        }
+
+        // Up to 3 reads of the slots not detected yet, all boards at once
+        for (let j = 0; j < 3; j++)
+        {
+            let slots = [];
+            let results = GeneralCommands.stationBatch(function (testClient, i)
+            {
+                let commands = [];
+
+                slots[i] = [];
                 testClient.setTimeout(300);
-                for (let j = 0; j < 3; j++)
+                for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
                 {
-                    let voltage = testClient.readAIN(slot, 4, 0);
+                    if (testClient.isDutAvailable(slot))
+                        continue;
+
+                    commands.push(["readAIN", slot, 4, 0]);
+                    slots[i].push(slot);
+                }
+
+                return commands;
+            });
+
+            for (let i = 0; i < testClientList.length; i++)
+            {
+                let testClient = testClientList[i];
+
+                if (results[i] === null)
+                    continue;
+
+                testClient.setTimeout(0);
+                for (let k = 0; k < results[i].length; k++)
+                {
+                    let slot = slots[i][k];
+                    let voltage = results[i][k];
 
                     if (voltage > 40000)
                     {
                         logger.logSuccess("Device connected to the slot " + testClient.dutNo(slot) + " detected.");
                         testClient.setDutProperty(slot, "state", 1);
                         testClient.setDutProperty(slot, "checked", true);
-                        break;
                     }
-                    logger.logDebug("12V result: " + testClient.no() + ", " + slot + ", " + voltage);
+                    else
+                        logger.logDebug("12V result: " + testClient.no() + ", " + slot + ", " + voltage);
                 }
-                testClient.setTimeout(10000);
             }
         }
 
@@ -155,26 +185,49 @@ NemaPP =
     {
         actionHintWidget.showProgressHint("Checking voltage on AIN1...");
 
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        // Median of a burst, so a single noisy read does not fail the DUT. All boards sample at once.
+        let slots = [];
+        let voltages = GeneralCommands.stationSamples(function (testClient, i)
         {
-            for (var i = 0; i < testClientList.length; i++)
+            let commands = [];
+
+            slots[i] = [];
+            for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
             {
-                let testClient = testClientList[i];
                 if(testClient.isDutAvailable(slot) && testClient.isDutChecked(slot))
                 {
-                    let voltage = testClient.readAIN(slot, 1, 0);
-                    if(voltage > 70000 && voltage < 72000)
-                    {
-                        testClientList[i].setDutProperty(slot, "voltageChecked", true);
-                        logger.logSuccess("Voltage (3.3V) on AIN 1 for DUT " + testClientList[i].dutNo(slot) + " is checked.");
-                    }
-                    else
-                    {
-                        testClientList[i].setDutProperty(slot, "voltageChecked", false);
-                        testClientList[i].addDutError(slot, "Error voltage on AIN1");
-                        logger.logDebug("Error voltage value on AIN 1 : " + voltage  + " for DUT " + testClientList[i].dutNo(slot));
-                        logger.logError("Error voltage value on AIN 1 is detected for DUT " + testClientList[i].dutNo(slot));
-                    }
+                    commands.push(["readAIN", slot, 1, 0]);
+                    slots[i].push(slot);
+                }
+            }
+
+            return commands;
+        }, 8);
+
+        for (let i = 0; i < testClientList.length; i++)
+        {
+            let testClient = testClientList[i];
+
+            if (voltages[i] === null)
+                continue;
+
+            for (let k = 0; k < voltages[i].length; k++)
+            {
+                let slot = slots[i][k];
+                let voltage = voltages[i][k];
+
+                if(voltage.count > 0 && voltage.median > 70000 && voltage.median < 72000)
+                {
+                    testClient.setDutProperty(slot, "voltageChecked", true);
+                    logger.logSuccess("Voltage (3.3V) on AIN 1 for DUT " + testClient.dutNo(slot) + " is checked.");
+                }
+                else
+                {
+                    testClient.setDutProperty(slot, "voltageChecked", false);
+                    testClient.addDutError(slot, "Error voltage on AIN1");
+                    logger.logDebug("Error voltage value on AIN 1 : " + voltage.median + " (min " + voltage.min + ", max " + voltage.max +
+                                    ", failed " + voltage.failed + ") for DUT " + testClient.dutNo(slot));
+                    logger.logError("Error voltage value on AIN 1 is detected for DUT " + testClient.dutNo(slot));
                 }
             }
         }
@@ -222,13 +275,11 @@ NemaPP =
                 if(testClientList[i].isDutAvailable(slot) && testClientList[i].isDutChecked(slot))
                 {
                     let testClient = testClientList[i];
-                    let response = testClient.railtestCommand(slot, "rtc");
-                    if (response.length < 7)
-                        response = testClient.railtestCommand(slot, "rtc");
+                    let reply = testClient.railtestReply(slot, "rtc");
+                    if (reply.fields.year === undefined)
+                        reply = testClient.railtestReply(slot, "rtc");
 
-                    let responseString = response.join(' ');
-
-                    if(responseString.includes("year:" + year))
+                    if(reply.fields.year === Number(year))
                     {
                         testClientList[i].setDutProperty(slot, "rtcChecked", true);
                         logger.logSuccess("RTC module for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
@@ -238,7 +289,7 @@ NemaPP =
                     {
                         testClientList[i].setDutProperty(slot, "rtcChecked", false);
                         logger.logError("RTC module testing for DUT " + testClient.dutNo(slot) + " has been failed.");
-                        logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + response.slice(7));
+                        logger.logDebug("RTC value for DUT " + testClient.dutNo(slot) + ": " + JSON.stringify(reply.fields));
                     }
                 }
             }
@@ -299,9 +350,9 @@ NemaPP =
                     delay(1000);
 
                     testClient.railtestCommand(slot, "dali 0xFE80 16 0 0");
-                    let responseString = testClient.railtestCommand(slot, "dali 0xFF90 16 0 1000000").join(' ');
+                    let reply = testClient.railtestReply(slot, "dali 0xFF90 16 0 1000000");
 
-                    if(responseString.includes("error:0"))
+                    if(reply.fields.error === 0)
                     {
                         testClient.setDutProperty(slot, "daliChecked", true);
                         logger.logSuccess("DALI interface for DUT " + testClient.dutNo(slot) + " has been tested successfully.");
@@ -310,9 +361,9 @@ NemaPP =
                     else
                     {
                         testClient.setDutProperty(slot, "daliChecked", false);
-                        testClient.addDutError(slot, responseString);
+                        testClient.addDutError(slot, reply.text);
                         logger.logError("DALI testing for DUT " + testClient.dutNo(slot) + " has been failed.");
-                        logger.logDebug("DALI failure: " + responseString  + ".");
+                        logger.logDebug("DALI failure: " + reply.text  + ".");
                     }
 
                     testClient.railtestCommand(slot, "dali 0xFE80 16 0 0");
@@ -378,6 +429,8 @@ NemaPP =
 
     checkTestingCompletion: function ()
     {
+        GeneralCommands.finishPowerProfiles();
+
         for(var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
             for (var i = 0; i < testClientList.length; i++)
@@ -424,6 +477,7 @@ methodManager.addFunctionToGeneralList("Download Railtest", NemaPP.downloadRailt
 methodManager.addFunctionToGeneralList("Read CSA", GeneralCommands.readCSA);
 methodManager.addFunctionToGeneralList("Read Temperature", GeneralCommands.readTemperature);
 methodManager.addFunctionToGeneralList("Supply power to DUTs", NemaPP.powerOn);
+methodManager.addFunctionToGeneralList("Speed up DUT debug UART", GeneralCommands.negotiateDutDebug);
 //methodManager.addFunctionToGeneralList("Test radio debug", NemaPP.testRadioDebug);
 methodManager.addFunctionToGeneralList("Power off DUTs", NemaPP.powerOff);
 methodManager.addFunctionToGeneralList("Read unique device identifiers (ID)", GeneralCommands.readChipId);
@@ -26,42 +26,64 @@ ZhagaSTD =
     {
         actionHintWidget.showProgressHint("Detecting DUTs in the testing fixture...");
 
-        for (var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        GeneralCommands.stationBatch(function (testClient)
         {
-            for (var i = 0; i < testClientList.length; i++)
-            {
-                let testClient = testClientList[i];
+            let commands = [];
 
-                if(!testClient.isConnected())
-                    continue;
-
-                testClient.powerOn(slot);
+            for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+            {
+                commands.push(["powerOn", slot]);
+                testClient.setDutProperty(slot, "state", 0);
+                testClient.setDutProperty(slot, "checked", false);
+                testClient.setDutProperty(slot, "voltageChecked", false);
             }
-        }
+
+            return commands;
+        });
         delay(1000);
 
-        for (slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+        // Up to 3 reads of the slots not detected yet, all boards at once
+        for (let j = 0; j < 3; j++)
         {
-            for (i = 0; i < testClientList.length; i++)
+            let slots = [];
+            let results = GeneralCommands.stationBatch(function (testClient, i)
             {
-                var testClient = testClientList[i];
+                let commands = [];
+                let boardSlots = [];
 
-                if(!testClient.isConnected())
+                for (let slot = 1; slot < SLOTS_NUMBER + 1; slot++)
+                {
+                    if (testClient.isDutAvailable(slot))
+                        continue;
+
+                    commands.push(["readAIN", slot, 1, 0]);
+                    boardSlots.push(slot);
+                }
+                slots[i] = boardSlots;
+
+                return commands;
+            });
+
+            for (let i = 0; i < testClientList.length; i++)
+            {
+                let testClient = testClientList[i];
+
+                if (results[i] === null)
                     continue;
 
-                testClient.setDutProperty(slot, "state", 0);
-                testClient.setDutProperty(slot, "checked", false);
-                testClientList[i].setDutProperty(slot, "voltageChecked", false);
-                for (j = 0; j < 3; j++)
-                    if (testClient.readAIN(slot, 1, 0) > 69000)
+                for (let k = 0; k < results[i].length; k++)
+                {
+                    let slot = slots[i][k];
+
+                    if (results[i][k] > 69000)
                     {
                         logger.logSuccess("Device connected to the slot " + slot + " of the test board " + testClient.no() + " detected.");
                         logger.logDebug("Device connected to the slot " + slot + " of the test board " + testClient.no() + " detected.");
                         testClient.setDutProperty(slot, "state", 1);
                         testClient.setDutProperty(slot, "checked", true);
-                        testClientList[i].setDutProperty(slot, "voltageChecked", true);
-                        break;
+                        testClient.setDutProperty(slot, "voltageChecked", true);
                     }
+                }
             }
         }
 
@@ -91,12 +113,12 @@ ZhagaSTD =
 
                     testClient.setDOUT(slot, 1);
                     delay(100);
-                    let response = testClient.railtestCommand(slot, "din");
+                    let reply = testClient.railtestReply(slot, "din");
 
                     testClient.clearDOUT(slot, 1);
                     delay(100);
-                    let response2 = testClient.railtestCommand(slot, "din");
-                    if(response.includes("state:1") && response2.includes("state:0"))
+                    let reply2 = testClient.railtestReply(slot, "din");
+                    if(reply.fields.state === 1 && reply2.fields.state === 0)
                     {
                         testClientList[i].setDutProperty(slot, "dinChecked", true);
                         logger.logSuccess("Digital input for DUT " + testClient.dutNo(slot) + " has been tested.");
@@ -156,6 +178,8 @@ ZhagaSTD =
 
     checkTestingCompletion: function ()
     {
+        GeneralCommands.finishPowerProfiles();
+
         for(var slot = 1; slot < SLOTS_NUMBER + 1; slot++)
         {
             for (var i = 0; i < testClientList.length; i++)
@@ -200,6 +224,7 @@ methodManager.addFunctionToGeneralList("Download Railtest", ZhagaSTD.downloadRai
 methodManager.addFunctionToGeneralList("Read CSA", GeneralCommands.readCSA);
 methodManager.addFunctionToGeneralList("Read Temperature", GeneralCommands.readTemperature);
 methodManager.addFunctionToGeneralList("Supply power to DUTs", GeneralCommands.powerOn);
+methodManager.addFunctionToGeneralList("Speed up DUT debug UART", GeneralCommands.negotiateDutDebug);
 methodManager.addFunctionToGeneralList("Power off DUTs", GeneralCommands.powerOff);
 methodManager.addFunctionToGeneralList("Read unique device identifiers (ID)", GeneralCommands.readChipId);
 methodManager.addFunctionToGeneralList("Test digital input", ZhagaSTD.testDIN);
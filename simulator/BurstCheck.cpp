@@ -0,0 +1,134 @@
+#include "portmanager.h"
+#include "BoardCommands.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QProcess>
+#include <QFileInfo>
+#include <QDir>
+#include <QThread>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// Bursts of board reads longer than the PortManager command queue.
+//
+// Starts MeasBoardSimulator from the same directory and sends the burst the way
+// TestClient::sampleBoard() does: every read waits for queue space, the writes are held.
+// Exits with 1 if a read of the burst is lost.
+//
+//   BurstCheck --reads 1000 --window 8 --config simulator.ini
+
+static bool _waitForLink(const QString &path, int msecs)
+{
+    QElapsedTimer timer;
+
+    timer.start();
+    while (!QFileInfo::exists(path))
+    {
+        if (timer.elapsed() > msecs)
+            return false;
+
+        QThread::msleep(20);
+    }
+
+    return true;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Board command bursts past the PortManager queue against the simulator.");
+    parser.addHelpOption();
+    parser.addOption({"reads", "Reads per burst.", "count", "1000"});
+    parser.addOption({"window", "Board commands in flight.", "count", "8"});
+    parser.addOption({{"c", "config"}, "Simulated board settings.", "file", "simulator.ini"});
+    parser.process(a);
+
+    int reads = qMax(1, parser.value("reads").toInt());
+    QString link = QDir::temp().filePath(QString("BurstCheck-%1").arg(QCoreApplication::applicationPid()));
+    QProcess simulator;
+
+    simulator.setProcessChannelMode(QProcess::ForwardedChannels);
+    simulator.start(QCoreApplication::applicationDirPath() + "/MeasBoardSimulator",
+                    {"--config", parser.value("config"), "--link", link});
+
+    if (!simulator.waitForStarted() || !_waitForLink(link, 5000))
+    {
+        qCritical() << "Measuring board simulator does not start:" << simulator.errorString();
+
+        return 1;
+    }
+
+    PortManager port;
+
+    port.setPort(link);
+    port.setWindowSize(parser.value("window").toInt());
+
+    if (!port.open())
+    {
+        simulator.kill();
+        simulator.waitForFinished();
+        QFile::remove(link);
+
+        return 1;
+    }
+
+    struct Burst
+    {
+        int replied = 0;
+        int failed = 0;
+        int rest = 0;
+        bool done = true;
+    } burst;
+
+    quint8 sequence = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    port.holdWrites();
+    for (int i = 0; i < reads; i++)
+    {
+        MB_ReadAnalog::Frame frame;
+
+        port.waitForQueueSpace();
+        MB_ReadAnalog::encode(frame, ++sequence, 1, 1, 0);
+        ++burst.rest;
+        burst.done = false;
+        port.boardCommandAsync(frame.data(), MB_ReadAnalog::size, [&burst](bool replied, qint32 code)
+        {
+            if (replied && code >= 0)
+                ++burst.replied;
+            else
+                ++burst.failed;
+
+            burst.done = (--burst.rest == 0);
+        });
+    }
+    port.releaseWrites();
+    port.waitForReply(burst.done);
+
+    qint64 msecs = timer.elapsed();
+    PortManager::LinkStats stats = port.linkStats();
+
+    port.close();
+    simulator.terminate();
+    simulator.waitForFinished();
+    QFile::remove(link);
+
+    qInfo().noquote() << QString("Burst of %1 reads (queue %2): replied %3, failed %4, %5 ms")
+                         .arg(reads).arg(PortManager::QUEUE_SIZE).arg(burst.replied).arg(burst.failed).arg(msecs);
+    qInfo().noquote() << QString("Timeouts %1, board queue full events %2")
+                         .arg(stats.timeouts).arg(stats.events.value(MB_EVENT_CMDQUEUE_FULL));
+
+    if (burst.replied != reads)
+    {
+        qCritical() << "Reads of the burst are lost past the command queue.";
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,508 @@
+#include "MeasBoardSimulator.h"
+
+#include <QtEndian>
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+#include <QRandomGenerator>
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdlib.h>
+#include <string.h>
+#include <termios.h>
+#include <unistd.h>
+
+// Expected MB_Packet_t::dataLen of the board commands, -1 - unknown command.
+static int _commandDataSize(int type)
+{
+    switch (type)
+    {
+        case MB_SYSTEM_RESET:       return 0;
+        case MB_SWITCH_SWD:         return 1;
+        case MB_SWITCH_POWER:       return 2;
+        case MB_READ_DIN:           return 2;
+        case MB_WRITE_DOUT:         return 3;
+        case MB_READ_CSA:           return 1;
+        case MB_READ_ANALOG:        return 3;
+        case MB_CONFIG_DUT_DEBUG:   return sizeof(MB_ConfigDutDebug_t) - sizeof(MB_Packet_t);
+        case MB_SWITCH_DALI:        return 1;
+        case MB_READ_DALI_ADC:      return 0;
+        case MB_READ_DIN_ADC:       return 2;
+        case MB_READ_ADC_24V:       return 0;
+        case MB_READ_ADC_3V:        return 0;
+        case MB_READ_ADC_TEMP:      return 0;
+        default:                    return -1;
+    }
+}
+
+MeasBoardSimulator::MeasBoardSimulator(const QSharedPointer<QSettings> &settings, QObject *parent)
+    : QObject(parent), _settings(settings), _commandTimer(this)
+{
+    _codec.setFrameHandler([this](int channel, const char *data, int size){onFrameDecoded(channel, data, size);});
+    _commandTimer.setSingleShot(true);
+
+    connect(&_commandTimer, &QTimer::timeout, this, &MeasBoardSimulator::onCommandTimer);
+
+    loadSettings();
+}
+
+MeasBoardSimulator::~MeasBoardSimulator()
+{
+    close();
+}
+
+void MeasBoardSimulator::loadSettings()
+{
+    _commandQueueSize = _settings->value("Board/commandQueueSize", 16).toInt();
+    _commandLatency = _settings->value("Board/commandLatency", 1).toInt();
+    _railtestLatency = _settings->value("Board/railtestLatency", 2).toInt();
+    _railtestChunkSize = qMax(1, _settings->value("Board/railtestChunkSize", 32).toInt());
+    _maxBaudRate = _settings->value("Board/maxBaudRate", 921600).toInt();
+
+    _csa = _settings->value("Board/csa", 40).toInt();
+    _adc24V = _settings->value("Board/adc24V", 52000).toInt();
+    _adc3V = _settings->value("Board/adc3V", 71000).toInt();
+    _adcTemp = _settings->value("Board/adcTemp", 28000).toInt();
+    _daliAdc = _settings->value("Board/daliAdc", 33000).toInt();
+    _noise = _settings->value("Board/noise", 0).toInt();
+
+    for (int dut = 1; dut <= DUT_COUNT; dut++)
+    {
+        Slot &s = _slots[dut];
+        QString group = QString("Slot%1/").arg(dut);
+
+        s.present = _settings->value(group + "present", true).toBool();
+        s.current = _settings->value(group + "current", 25).toInt();
+
+        for (int ain = 1; ain <= AIN_COUNT; ain++)
+            s.ain[ain] = _settings->value(group + QString("ain%1").arg(ain), ain == 1 ? 71000 : 45000).toInt();
+
+        for (int din = 1; din <= DIN_COUNT; din++)
+        {
+            s.din[din] = _settings->value(group + QString("din%1").arg(din), 0).toInt();
+            s.dinAdc[din] = _settings->value(group + QString("dinAdc%1").arg(din), 1000).toInt();
+        }
+
+        s.console.configure(_settings, dut);
+    }
+}
+
+bool MeasBoardSimulator::open(const QString &linkPath)
+{
+    close();
+
+    _masterFd = posix_openpt(O_RDWR | O_NOCTTY);
+
+    if (_masterFd < 0 || grantpt(_masterFd) || unlockpt(_masterFd))
+    {
+        qCritical() << "Cannot create pseudo-terminal:" << strerror(errno);
+        close();
+
+        return false;
+    }
+
+    _portName = QString::fromLocal8Bit(ptsname(_masterFd));
+
+    // Keep the slave side open, so the master does not get EIO between client sessions.
+    _slaveFd = ::open(ptsname(_masterFd), O_RDWR | O_NOCTTY);
+
+    if (_slaveFd < 0)
+    {
+        qCritical() << "Cannot open pseudo-terminal" << _portName << ":" << strerror(errno);
+        close();
+
+        return false;
+    }
+
+    termios tio;
+
+    tcgetattr(_slaveFd, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(_slaveFd, TCSANOW, &tio);
+    fcntl(_masterFd, F_SETFL, fcntl(_masterFd, F_GETFL) | O_NONBLOCK);
+
+    if (!linkPath.isEmpty())
+    {
+        if (QFileInfo(linkPath).isSymLink())
+            QFile::remove(linkPath);
+
+        if (QFile::link(_portName, linkPath))
+            _linkPath = linkPath;
+        else
+            qWarning() << "Cannot create symlink" << linkPath << "to" << _portName;
+    }
+
+    _readNotifier = new QSocketNotifier(_masterFd, QSocketNotifier::Read, this);
+    _writeNotifier = new QSocketNotifier(_masterFd, QSocketNotifier::Write, this);
+    _writeNotifier->setEnabled(false);
+
+    connect(_readNotifier, &QSocketNotifier::activated, this, &MeasBoardSimulator::onReadable);
+    connect(_writeNotifier, &QSocketNotifier::activated, this, &MeasBoardSimulator::onWritable);
+
+    reset();
+
+    return true;
+}
+
+void MeasBoardSimulator::close()
+{
+    delete _readNotifier;
+    _readNotifier = nullptr;
+    delete _writeNotifier;
+    _writeNotifier = nullptr;
+
+    if (!_linkPath.isEmpty())
+    {
+        QFile::remove(_linkPath);
+        _linkPath.clear();
+    }
+
+    if (_slaveFd >= 0)
+        ::close(_slaveFd);
+
+    if (_masterFd >= 0)
+        ::close(_masterFd);
+
+    _slaveFd = _masterFd = -1;
+    _txPending.clear();
+    _commandTimer.stop();
+    _commands.clear();
+}
+
+void MeasBoardSimulator::reset()
+{
+    _commands.clear();
+    _commandTimer.stop();
+    _codec.reset();
+    _dali = false;
+
+    for (int dut = 1; dut <= DUT_COUNT; dut++)
+    {
+        _slots[dut].powered = false;
+        _slots[dut].baudRate = RailtestConsole::DEFAULT_BAUD_RATE;
+        _slots[dut].console.reset();
+        _slots[dut].console.setDin(false);
+    }
+
+    MB_Packet_t startup;
+
+    startup.type = qToBigEndian<uint16_t>(MB_STARTUP);
+    startup.sequence = 0;
+    startup.dataLen = 0;
+
+    sendFrame(0, (const char*)&startup, sizeof(startup));
+}
+
+void MeasBoardSimulator::onReadable()
+{
+    forever
+    {
+        int size;
+        char *buffer = _codec.receiveBuffer(&size);
+        ssize_t n = ::read(_masterFd, buffer, size);
+
+        if (n <= 0)
+            break;
+
+        _codec.commit(n);
+    }
+}
+
+void MeasBoardSimulator::onWritable()
+{
+    ssize_t n = ::write(_masterFd, _txPending.constData(), _txPending.size());
+
+    if (n > 0)
+        _txPending.remove(0, n);
+
+    if (_txPending.isEmpty())
+        _writeNotifier->setEnabled(false);
+}
+
+void MeasBoardSimulator::onFrameDecoded(int channel, const char *data, int size)
+{
+    if (channel > DUT_COUNT)
+    {
+        sendEvent(MB_EVENT_INVALID_CHANNEL);
+        return;
+    }
+
+    if (channel != 0)
+    {
+        onRailtestInput(channel, data, size);
+        return;
+    }
+
+    if (size > MAX_COMMAND_SIZE)
+    {
+        sendEvent(MB_EVENT_COMMAND_TOO_LONG);
+        return;
+    }
+
+    // Like the firmware, the board drops the command which does not fit into its queue.
+    if (_commands.size() >= _commandQueueSize)
+    {
+        sendEvent(MB_EVENT_CMDQUEUE_FULL);
+        return;
+    }
+
+    _commands.enqueue(QByteArray(data, size));
+
+    if (!_commandTimer.isActive())
+        _commandTimer.start(_commandLatency);
+}
+
+void MeasBoardSimulator::onCommandTimer()
+{
+    if (_commands.isEmpty())
+        return;
+
+    QByteArray command = _commands.dequeue();
+
+    if (command.size() >= (int)sizeof(MB_Packet_t)
+        && qFromBigEndian(((const MB_Packet_t*)command.constData())->type) == MB_SYSTEM_RESET)
+    {
+        reset();
+        return;
+    }
+
+    MB_GeneralResult_t result;
+
+    result.header.type = qToBigEndian<uint16_t>(MB_GENERAL_RESULT);
+    result.header.sequence = command.size() >= (int)sizeof(MB_Packet_t) ? ((const MB_Packet_t*)command.constData())->sequence : 0;
+    result.header.dataLen = sizeof(result.errorCode);
+    result.errorCode = qToBigEndian<int32_t>(execute(command));
+
+    sendFrame(0, (const char*)&result, sizeof(result));
+
+    if (!_commands.isEmpty())
+        _commandTimer.start(_commandLatency);
+}
+
+MeasBoardSimulator::Slot *MeasBoardSimulator::slot(int dut)
+{
+    return (dut >= 1 && dut <= DUT_COUNT) ? &_slots[dut] : nullptr;
+}
+
+int MeasBoardSimulator::measure(int value) const
+{
+    if (_noise > 0)
+        value += QRandomGenerator::global()->bounded(-_noise, _noise + 1);
+
+    return value;
+}
+
+qint32 MeasBoardSimulator::execute(const QByteArray &command)
+{
+    if (command.size() < (int)sizeof(MB_Packet_t))
+        return MB_ERROR_COMMAND_TOO_SHORT;
+
+    const MB_Packet_t *header = (const MB_Packet_t*)command.constData();
+    const quint8 *data = (const quint8*)command.constData() + sizeof(MB_Packet_t);
+    int type = qFromBigEndian(header->type);
+    int dataSize = _commandDataSize(type);
+
+    if (dataSize < 0)
+        return MB_ERROR_INVALID_PACKET_TYPE;
+
+    if (header->dataLen != command.size() - (int)sizeof(MB_Packet_t) || header->dataLen != dataSize)
+        return MB_ERROR_INVALID_DATA_SIZE;
+
+    switch (type)
+    {
+        case MB_SWITCH_SWD:
+            return slot(data[0]) ? MB_NO_ERROR : MB_ERROR_INVALID_ARGUMENT;
+
+        case MB_SWITCH_POWER:
+        {
+            Slot *s = slot(data[0]);
+
+            if (!s)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            bool powerOn = data[1] && !s->powered;
+
+            s->powered = data[1];
+
+            if (powerOn && s->present && s->baudRate == s->console.baudRate())
+            {
+                s->console.reset();
+                QByteArray banner = s->console.banner();
+                sendFrame(data[0], banner.constData(), banner.size());
+            }
+
+            return MB_NO_ERROR;
+        }
+
+        case MB_READ_DIN:
+        {
+            Slot *s = slot(data[0]);
+
+            if (!s || data[1] < 1 || data[1] > DIN_COUNT)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            return s->din[data[1]];
+        }
+
+        case MB_WRITE_DOUT:
+        {
+            Slot *s = slot(data[0]);
+
+            if (!s || data[1] < 1 || data[1] > DIN_COUNT)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            // DOUT 1 of the board drives DIN of the DUT
+            if (data[1] == 1)
+                s->console.setDin(data[2]);
+
+            return MB_NO_ERROR;
+        }
+
+        case MB_READ_CSA:
+        {
+            int value = _csa;
+
+            for (int dut = 1; dut <= DUT_COUNT; dut++)
+                if (_slots[dut].present && _slots[dut].powered)
+                    value += _slots[dut].current;
+
+            return measure(value);
+        }
+
+        case MB_READ_ANALOG:
+        {
+            Slot *s = slot(data[0]);
+
+            if (!s || data[1] < 1 || data[1] > AIN_COUNT)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            return s->present ? measure(s->ain[data[1]]) : 0;
+        }
+
+        case MB_CONFIG_DUT_DEBUG:
+        {
+            const MB_ConfigDutDebug_t *config = (const MB_ConfigDutDebug_t*)command.constData();
+            Slot *s = slot(config->dutIndex);
+            quint32 baudRate = qFromBigEndian(config->baudRate);
+
+            if (!s
+                || baudRate == 0
+                || (config->bits != 8 && config->bits != 9)
+                || config->parity > 2
+                || (config->stopBits != 1 && config->stopBits != 2))
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            if (baudRate > (quint32)_maxBaudRate)
+                return MB_ERROR_UART_INIT;
+
+            s->baudRate = baudRate;
+
+            return MB_NO_ERROR;
+        }
+
+        case MB_SWITCH_DALI:
+            _dali = data[0];
+            return MB_NO_ERROR;
+
+        case MB_READ_DALI_ADC:
+            return measure(_dali ? _daliAdc : 0);
+
+        case MB_READ_DIN_ADC:
+        {
+            Slot *s = slot(data[0]);
+
+            if (!s || data[1] < 1 || data[1] > DIN_COUNT)
+                return MB_ERROR_INVALID_ARGUMENT;
+
+            return s->present ? measure(s->dinAdc[data[1]]) : 0;
+        }
+
+        case MB_READ_ADC_24V:
+            return measure(_adc24V);
+
+        case MB_READ_ADC_3V:
+            return measure(_adc3V);
+
+        case MB_READ_ADC_TEMP:
+            return measure(_adcTemp);
+
+        default:
+            return MB_ERROR_INVALID_PACKET_TYPE;
+    }
+}
+
+void MeasBoardSimulator::onRailtestInput(int channel, const char *data, int size)
+{
+    Slot *s = slot(channel);
+    QList<QByteArray> commands;
+
+    if (!s->console.feed(data, size, &commands))
+        sendEvent(MB_EVENT_DUTDBGTX_FULL);
+
+    // Characters sent at a wrong speed never make a valid command line.
+    if (!s->present || s->baudRate != s->console.baudRate())
+        return;
+
+    for (auto & command : commands)
+    {
+        int baudRate = s->console.baudRate();
+        QByteArray output = s->console.execute(command);
+
+        // The reply takes its time on the DUT UART (10 bits per byte)
+        // and reaches the host in several frames, as on the real board.
+        int msecs = _railtestLatency + int(qint64(output.size()) * 10000 / baudRate);
+
+        QTimer::singleShot(msecs, this, [this, channel, output]()
+        {
+            for (int pos = 0; pos < output.size(); pos += _railtestChunkSize)
+                sendFrame(channel, output.constData() + pos, qMin(_railtestChunkSize, output.size() - pos));
+        });
+    }
+}
+
+void MeasBoardSimulator::sendEvent(qint32 eventCode)
+{
+    MB_Event_t event;
+
+    event.header.type = qToBigEndian<uint16_t>(MB_ASYNC_EVENT);
+    event.header.sequence = 0;
+    event.header.dataLen = sizeof(event.eventCode);
+    event.eventCode = qToBigEndian<int32_t>(eventCode);
+
+    sendFrame(0, (const char*)&event, sizeof(event));
+}
+
+void MeasBoardSimulator::sendFrame(int channel, const char *data, int size)
+{
+    int encodedSize = _codec.encode(channel, data, size);
+
+    write(_codec.encodedData(), encodedSize);
+}
+
+void MeasBoardSimulator::write(const char *data, int size)
+{
+    if (_masterFd < 0)
+        return;
+
+    if (_txPending.isEmpty())
+    {
+        ssize_t n = ::write(_masterFd, data, size);
+
+        if (n < 0 && errno != EAGAIN)
+        {
+            qWarning() << "Pseudo-terminal write error:" << strerror(errno);
+            return;
+        }
+
+        if (n == size)
+            return;
+
+        n = qMax<ssize_t>(n, 0);
+        data += n;
+        size -= n;
+    }
+
+    _txPending.append(data, size);
+    _writeNotifier->setEnabled(true);
+}
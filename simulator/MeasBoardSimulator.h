@@ -0,0 +1,102 @@
+#ifndef MEASBOARDSIMULATOR_H
+#define MEASBOARDSIMULATOR_H
+
+#include <QObject>
+#include <QSettings>
+#include <QSharedPointer>
+#include <QSocketNotifier>
+#include <QTimer>
+#include <QQueue>
+
+#include "SlipProtocol.h"
+#include "SlipCodec.h"
+#include "RailtestConsole.h"
+
+// Measuring board firmware model behind a pseudo-terminal.
+// The slave side of the PTY is opened by PortManager as an ordinary serial port.
+class MeasBoardSimulator : public QObject
+{
+    Q_OBJECT
+
+public:
+
+    explicit MeasBoardSimulator(const QSharedPointer<QSettings> &settings, QObject *parent = nullptr);
+    ~MeasBoardSimulator();
+
+    // Creates the PTY and optionally a symlink to its slave side.
+    bool open(const QString &linkPath = QString());
+    void close();
+
+    QString portName() const {return _portName;}
+
+public slots:
+
+    // Power-on state of the board, announced with MB_STARTUP.
+    void reset();
+
+private slots:
+
+    void onReadable();
+    void onWritable();
+    void onCommandTimer();
+
+private:
+
+    static constexpr int DUT_COUNT = 3;
+    static constexpr int AIN_COUNT = 4;
+    static constexpr int DIN_COUNT = 2;
+    static constexpr int MAX_COMMAND_SIZE = 64;
+
+    struct Slot
+    {
+        bool present = true;
+        bool powered = false;
+        int ain[AIN_COUNT + 1] = {};            // Index 0 is unused, as in the protocol
+        int din[DIN_COUNT + 1] = {};
+        int dinAdc[DIN_COUNT + 1] = {};
+        int current = 0;                        // CSA contribution of the powered DUT
+        int baudRate = RailtestConsole::DEFAULT_BAUD_RATE;
+        RailtestConsole console;
+    };
+
+    QSharedPointer<QSettings> _settings;
+    SlipCodec _codec;
+
+    int _masterFd = -1;
+    int _slaveFd = -1;
+    QString _portName;
+    QString _linkPath;
+    QSocketNotifier *_readNotifier = nullptr;
+    QSocketNotifier *_writeNotifier = nullptr;
+    QByteArray _txPending;
+
+    // Board command queue, served one command per latency period
+    QQueue<QByteArray> _commands;
+    QTimer _commandTimer;
+    int _commandQueueSize = 16;
+    int _commandLatency = 1;
+    int _railtestLatency = 2;
+    int _railtestChunkSize = 32;
+    int _maxBaudRate = 921600;
+
+    int _csa = 0;
+    int _adc24V = 0;
+    int _adc3V = 0;
+    int _adcTemp = 0;
+    int _daliAdc = 0;
+    int _noise = 0;
+    bool _dali = false;
+    Slot _slots[DUT_COUNT + 1];                 // Index 0 is unused
+
+    void loadSettings();
+    void onFrameDecoded(int channel, const char *data, int size);
+    void onRailtestInput(int channel, const char *data, int size);
+    qint32 execute(const QByteArray &command);
+    Slot *slot(int dut);
+    int measure(int value) const;
+    void sendEvent(qint32 eventCode);
+    void sendFrame(int channel, const char *data, int size);
+    void write(const char *data, int size);
+};
+
+#endif // MEASBOARDSIMULATOR_H
@@ -0,0 +1,114 @@
+#include "RailtestEngine.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDebug>
+
+// Throughput of the railtest output decoding against the DUT UART line rate.
+//
+// The stream is a reference radio session: "rx 1" reply followed by a burst of rxPacket
+// records, fed in SLIP frame sized chunks as PortManager receives them.
+//
+//   RailtestBenchmark --packets 200 --chunk 32 --baud 921600
+
+static QByteArray _makeStream(int packets)
+{
+    QByteArray stream = "\r\n{{(rx)}{Rx:Enabled}{Idle:Disabled}{Time:12345678}}\r\n> ";
+
+    for (int i = 0; i < packets; ++i)
+        stream += QString("\r\n{{(rxPacket)}{len:16}{timeUs:%1}{timePos:3}{crc:Pass}{rssi:%2}{lqi:255}{phy:0}{isAck:False}{syncWordId:0}{antenna:0}{channelHopIdx:255}{payload: 0x0f 0x16 0x11 0x22 0x33 0x44 0x55 0x66 0x77 0x88 0x99 0xaa 0xbb 0xcc 0xdd 0xee}}")
+                  .arg(1000000 + i * 625).arg(-40 - i % 20).toLatin1();
+
+    return stream + "\r\n> ";
+}
+
+// Line splitting as RailtestClient did before the engine: a buffer copy per line.
+static int _legacySplit(const QByteArray &stream, int chunkSize)
+{
+    QByteArray buffer;
+    int lines = 0;
+
+    for (int pos = 0; pos < stream.size(); pos += chunkSize)
+    {
+        buffer += stream.mid(pos, chunkSize);
+
+        int idx = buffer.indexOf("\r\n");
+
+        while (idx != -1)
+        {
+            if (buffer.startsWith("{{"))
+                ++lines;
+
+            buffer = buffer.mid(idx + 2);
+            idx = buffer.indexOf("\r\n");
+        }
+    }
+
+    return lines;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Railtest decoding throughput benchmark.");
+    parser.addHelpOption();
+    parser.addOption({"packets", "rxPacket records per session.", "count", "200"});
+    parser.addOption({"chunk", "Bytes per received SLIP frame.", "bytes", "32"});
+    parser.addOption({"baud", "Simulated DUT UART baud rate.", "rate", "921600"});
+    parser.addOption({"sessions", "Number of sessions to decode.", "count", "2000"});
+    parser.process(a);
+
+    int packets = parser.value("packets").toInt();
+    int chunkSize = qMax(1, parser.value("chunk").toInt());
+    double lineRate = parser.value("baud").toDouble() / 10;   // 8N1: 10 bits per byte
+    int sessions = qMax(1, parser.value("sessions").toInt());
+
+    QByteArray stream = _makeStream(packets);
+    RailtestEngine engine;
+    int records = 0;
+    int replies = 0;
+    int rssiSum = 0;
+
+    engine.setRecordHandler([&](const RailtestReply &record)
+    {
+        ++records;
+        rssiSum += record.value("rssi").toInt();
+    });
+
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < sessions; ++i)
+    {
+        engine.expect("rx", [&](const RailtestReply &){++replies;});
+
+        for (int pos = 0; pos < stream.size(); pos += chunkSize)
+            engine.feed(stream.constData() + pos, qMin(chunkSize, stream.size() - pos));
+    }
+
+    double engineSecs = timer.nsecsElapsed() / 1e9;
+
+    timer.restart();
+
+    int legacyLines = 0;
+
+    for (int i = 0; i < sessions; ++i)
+        legacyLines += _legacySplit(stream, chunkSize);
+
+    double legacySecs = timer.nsecsElapsed() / 1e9;
+    double bytes = double(stream.size()) * sessions;
+
+    qInfo().noquote() << QString("Session: %1 bytes, %2 records, %3 ms on the wire at %4 baud")
+                         .arg(stream.size()).arg(packets + 1).arg(stream.size() / lineRate * 1000, 0, 'f', 1).arg(lineRate * 10);
+    qInfo().noquote() << QString("Engine (split + parse): %1 MB/s, %2x line rate, %3 records, %4 replies, rssi sum %5")
+                         .arg(bytes / engineSecs / 1e6, 0, 'f', 1).arg(bytes / engineSecs / lineRate, 0, 'f', 0)
+                         .arg(records).arg(replies).arg(rssiSum);
+    qInfo().noquote() << QString("Legacy (split only):    %1 MB/s, %2x line rate, %3 lines")
+                         .arg(bytes / legacySecs / 1e6, 0, 'f', 1).arg(bytes / legacySecs / lineRate, 0, 'f', 0).arg(legacyLines);
+
+    return 0;
+}
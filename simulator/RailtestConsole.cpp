@@ -0,0 +1,190 @@
+#include "RailtestConsole.h"
+
+#include <QStringList>
+
+void RailtestConsole::configure(const QSharedPointer<QSettings> &settings, int slot)
+{
+    QString group = QString("Slot%1/").arg(slot);
+
+    quint64 id = settings->value(group + "id", QString("0123456789ABCD%1").arg(slot, 2, 10, QChar('0'))).toString().toULongLong(nullptr, 16);
+    _uniqueId[0] = quint32(id);
+    _uniqueId[1] = quint32(id >> 32);
+
+    auto accl = settings->value(group + "accl", "0.5|-0.3|98.1").toString().split("|");
+    for (int i = 0; i < 3; i++)
+        _accl[i] = i < accl.size() ? accl[i].toDouble() : 0.0;
+
+    _opwr = settings->value(group + "opwr", 250).toInt();
+    _gnssLine = settings->value(group + "gnss", "$GPGGA,120000.00,5546.0000,N,03737.0000,E,1,08,1.0,150.0,M,14.0,M,,*4A").toByteArray();
+
+    reset();
+}
+
+void RailtestConsole::reset()
+{
+    _input.clear();
+    _rxState = 0;
+    _channel = 0;
+    _power = 0;
+    _baudRate = DEFAULT_BAUD_RATE;
+}
+
+bool RailtestConsole::feed(const char *data, int size, QList<QByteArray> *commands)
+{
+    for (int i = 0; i < size; i++)
+    {
+        char ch = data[i];
+
+        if (ch == '\r' || ch == '\n')
+        {
+            QByteArray line = _input.trimmed();
+
+            _input.clear();
+            if (!line.isEmpty())
+                commands->append(line);
+        }
+        else if (_input.size() < INPUT_BUFFER_SIZE)
+        {
+            _input.append(ch);
+        }
+        else
+        {
+            _input.clear();
+            return false;
+        }
+    }
+
+    return true;
+}
+
+QByteArray RailtestConsole::item(const QByteArray &key, const QByteArray &value)
+{
+    return "{" + key + ":" + value + "}";
+}
+
+QByteArray RailtestConsole::banner() const
+{
+    return "\r\n{{(reset)}{app:railtest}{version:2.7.0}}\r\n> ";
+}
+
+QByteArray RailtestConsole::execute(const QByteArray &line)
+{
+    QList<QByteArray> args = line.simplified().split(' ');
+    QByteArray cmd = args.takeFirst();
+    QByteArray reply = "{{(" + cmd + ")}";
+    QByteArray lines;
+
+    if (cmd == "getmemw" && args.size() >= 1)
+    {
+        // All words in one record: {{(getmemw)}{address}{value}{address}{value}...}
+        quint32 address = args[0].toUInt(nullptr, 0);
+        int count = args.size() > 1 ? args[1].toInt() : 1;
+
+        for (int i = 0; i < count; i++, address += 4)
+        {
+            // Unique ID words of the chip, zeros elsewhere
+            quint32 value = 0;
+
+            if (address == 0x0FE081F0)
+                value = _uniqueId[0];
+            else if (address == 0x0FE081F4)
+                value = _uniqueId[1];
+
+            reply += "{0x" + QByteArray::number(address, 16).rightJustified(8, '0') + "}{0x" + QByteArray::number(value, 16).rightJustified(8, '0') + "}";
+        }
+    }
+    else if (cmd == "accl")
+    {
+        reply += item("X", QByteArray::number(_accl[0], 'f', 2));
+        reply += item("Y", QByteArray::number(_accl[1], 'f', 2));
+        reply += item("Z", QByteArray::number(_accl[2], 'f', 2));
+    }
+    else if (cmd == "lsen")
+    {
+        reply += item("opwr", number(_opwr));
+    }
+    else if (cmd == "din")
+    {
+        reply += item("state", number(_din ? 1 : 0));
+    }
+    else if (cmd == "srtc" && args.size() >= 6)
+    {
+        // Year has two digits, month is zero based
+        QDateTime rtc(QDate(2000 + args[0].toInt(), args[1].toInt() + 1, args[2].toInt()),
+                      QTime(args[3].toInt(), args[4].toInt(), args[5].toInt()));
+
+        if (rtc.isValid())
+        {
+            _rtcOffset = QDateTime::currentDateTime().secsTo(rtc);
+            reply += item("status", "ok");
+        }
+        else
+        {
+            reply += item("error", "invalid argument");
+        }
+    }
+    else if (cmd == "rtc")
+    {
+        QDateTime rtc = QDateTime::currentDateTime().addSecs(_rtcOffset);
+
+        reply += item("year", number(rtc.date().year() - 2000));
+        reply += item("month", number(rtc.date().month() - 1));
+        reply += item("day", number(rtc.date().day()));
+        reply += item("hour", number(rtc.time().hour()));
+        reply += item("min", number(rtc.time().minute()));
+        reply += item("sec", number(rtc.time().second()));
+    }
+    else if (cmd == "dali")
+    {
+        reply += item("error", "0");
+        reply += item("reply_bits", "8");
+        reply += item("reply", "0xFF");
+    }
+    else if (cmd == "gnrx")
+    {
+        int count = args.isEmpty() ? 1 : args[0].toInt();
+
+        for (int i = 0; i < count; i++)
+            lines += "\r\n{{(gnrx)}" + item("line", _gnssLine) + "}";
+    }
+    else if (cmd == "rx")
+    {
+        _rxState = args.isEmpty() ? _rxState : args[0].toInt();
+        reply += item("Rx", _rxState ? "Enabled" : "Disabled");
+    }
+    else if (cmd == "setChannel")
+    {
+        _channel = args.isEmpty() ? _channel : args[0].toInt();
+        reply += item("channel", number(_channel));
+    }
+    else if (cmd == "setPower")
+    {
+        _power = args.isEmpty() ? _power : args[0].toInt();
+        reply += item("powerLevel", number(_power));
+    }
+    else if (cmd == "tx")
+    {
+        reply += item("PacketTx", "Enabled");
+        reply += item("count", args.isEmpty() ? "0" : args[0]);
+    }
+    else if (cmd == "setUartBaudRate" && !args.isEmpty() && args[0].toInt() > 0)
+    {
+        reply += item("baudRate", args[0]);
+        _baudRate = args[0].toInt();
+    }
+    else if (cmd == "reset")
+    {
+        reset();
+        return banner();
+    }
+    else if (cmd == "setBleMode" || cmd == "setBle1Mbps" || cmd == "setTxDelay")
+    {
+        reply += item(cmd.mid(3), args.isEmpty() ? "0" : args[0]);
+    }
+    else
+    {
+        reply += item("error", "unknown command");
+    }
+
+    return "\r\n" + reply + "}" + lines + "\r\n> ";
+}
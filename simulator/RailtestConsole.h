@@ -0,0 +1,58 @@
+#ifndef RAILTESTCONSOLE_H
+#define RAILTESTCONSOLE_H
+
+#include <QSettings>
+#include <QSharedPointer>
+#include <QByteArray>
+#include <QList>
+#include <QDateTime>
+
+// Railtest command line of a simulated DUT.
+// Replies follow the railtest format: {{(cmd)}{key:value}...} lines terminated by the "\r\n> " prompt.
+class RailtestConsole
+{
+public:
+
+    static constexpr int INPUT_BUFFER_SIZE = 256;
+    static constexpr int DEFAULT_BAUD_RATE = 115200;
+
+    RailtestConsole() {}
+
+    void configure(const QSharedPointer<QSettings> &settings, int slot);
+    void reset();
+
+    // Collects received characters. Returns false when the input buffer overflows.
+    bool feed(const char *data, int size, QList<QByteArray> *commands);
+
+    // Executes the command line and returns the whole console output for it.
+    QByteArray execute(const QByteArray &line);
+
+    // Startup banner printed after power-on or "reset".
+    QByteArray banner() const;
+
+    // DIN of the DUT is wired to the DOUT of the measuring board.
+    void setDin(bool state) {_din = state;}
+
+    // Console UART speed, changed by "setUartBaudRate" after its reply is sent.
+    int baudRate() const {return _baudRate;}
+
+private:
+
+    QByteArray _input;
+    bool _din = false;
+
+    quint32 _uniqueId[2] = {0, 0};
+    double _accl[3] = {0.0, 0.0, 0.0};
+    int _opwr = 0;
+    QByteArray _gnssLine;
+    qint64 _rtcOffset = 0;                  // RTC minus host clock, seconds
+    int _rxState = 0;                       // Radio settings echoed back by the commands
+    int _channel = 0;
+    int _power = 0;
+    int _baudRate = DEFAULT_BAUD_RATE;
+
+    static QByteArray item(const QByteArray &key, const QByteArray &value);
+    static QByteArray number(qint64 value) {return QByteArray::number(value);}
+};
+
+#endif // RAILTESTCONSOLE_H
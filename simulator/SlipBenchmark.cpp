@@ -0,0 +1,158 @@
+#include "SlipCodec.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <atomic>
+#include <new>
+#include <stdlib.h>
+#include <string.h>
+
+// SLIP encode/decode throughput and the steady-state heap allocations of SlipCodec.
+//
+// Frames are board command sized with payloads full of END/ESC octets, the encoded stream
+// is received through the in-place receiveBuffer()/commit() path in chunks of the given size.
+// Exits with 1 if the codec allocates after the warm-up pass or a frame is lost.
+//
+//   SlipBenchmark --frames 100000 --chunk 64
+
+static std::atomic<quint64> _allocations {0};
+
+void *operator new(std::size_t size)
+{
+    ++_allocations;
+
+    if (void *p = malloc(size ? size : 1))
+        return p;
+
+    throw std::bad_alloc();
+}
+
+void *operator new[](std::size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *p) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+void operator delete[](void *p) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+void operator delete(void *p, std::size_t) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+void operator delete[](void *p, std::size_t) Q_DECL_NOTHROW
+{
+    free(p);
+}
+
+struct Counters
+{
+    quint64 frames = 0;
+    quint64 bytes = 0;
+    quint32 checksum = 0;
+};
+
+// One pass: every frame is encoded, then received back in chunks. Returns the encoded bytes.
+static quint64 _pass(SlipCodec &encoder, SlipCodec &decoder, const QByteArray &payload, int frames, int chunkSize)
+{
+    quint64 encoded = 0;
+
+    for (int i = 0; i < frames; ++i)
+    {
+        int size = 4 + i % (payload.size() - 4);
+        int encodedSize = encoder.encode(1 + i % 3, payload.constData(), size);
+        const char *data = encoder.encodedData();
+
+        encoded += encodedSize;
+        while (encodedSize > 0)
+        {
+            int freeSize;
+            char *buffer = decoder.receiveBuffer(&freeSize);
+            int chunk = qMin(qMin(chunkSize, freeSize), encodedSize);
+
+            memcpy(buffer, data, chunk);
+            decoder.commit(chunk);
+            data += chunk;
+            encodedSize -= chunk;
+        }
+    }
+
+    return encoded;
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("SLIP codec throughput and allocation benchmark.");
+    parser.addHelpOption();
+    parser.addOption({"frames", "Frames per pass.", "count", "100000"});
+    parser.addOption({"chunk", "Bytes per received chunk.", "bytes", "64"});
+    parser.addOption({"passes", "Measured passes.", "count", "10"});
+    parser.process(a);
+
+    int frames = qMax(1, parser.value("frames").toInt());
+    int chunkSize = qMax(1, parser.value("chunk").toInt());
+    int passes = qMax(1, parser.value("passes").toInt());
+
+    // Board command frames are up to 64 bytes, every third byte needs escaping.
+    QByteArray payload(64, 0);
+
+    for (int i = 0; i < payload.size(); ++i)
+        payload[i] = (i % 3 == 0) ? char(0xC0) : (i % 3 == 1) ? char(0xDB) : char(i);
+
+    Counters counters;
+    SlipCodec encoder;
+    SlipCodec decoder([&counters](int channel, const char *data, int size)
+    {
+        ++counters.frames;
+        counters.bytes += size;
+        counters.checksum += channel + quint8(data[size - 1]);
+    });
+
+    // Warm-up: the transmit buffer grows to the largest frame here.
+    _pass(encoder, decoder, payload, frames, chunkSize);
+    counters = Counters();
+
+    quint64 allocations = _allocations;
+    quint64 encoded = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int i = 0; i < passes; ++i)
+        encoded += _pass(encoder, decoder, payload, frames, chunkSize);
+
+    double secs = timer.nsecsElapsed() / 1e9;
+
+    allocations = _allocations - allocations;
+
+    const SlipCodec::Stats &stats = decoder.stats();
+
+    qInfo().noquote() << QString("Encode + decode: %1 frames, %2 MB/s encoded, %3 Mframes/s, checksum %4")
+                         .arg(counters.frames).arg(encoded / secs / 1e6, 0, 'f', 1)
+                         .arg(counters.frames / secs / 1e6, 0, 'f', 2).arg(counters.checksum);
+    qInfo().noquote() << QString("Steady-state heap allocations: %1").arg(allocations);
+    qInfo().noquote() << QString("Errors: CRC %1, escape %2, short %3, long %4")
+                         .arg(stats.crcErrors).arg(stats.escapeErrors).arg(stats.shortFrames).arg(stats.longFrames);
+
+    if (allocations != 0 || counters.frames != quint64(frames) * passes)
+    {
+        qCritical() << "SLIP codec allocates in the steady state or loses frames.";
+
+        return 1;
+    }
+
+    return 0;
+}
@@ -0,0 +1,134 @@
+#include "LinkTrace.h"
+#include "SlipCodec.h"
+#include "SlipProtocol.h"
+#include "RailtestEngine.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QtEndian>
+#include <QMap>
+#include <QDebug>
+
+// Decodes a link trace recorded by PortManager::startCapture() without hardware:
+// the received data goes through the SLIP codec and the railtest engines as on the station.
+//
+//   TraceReplay MB1_20240101_120000.mblt [--realtime] [--repeat 100] [--verbose]
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Measuring board link trace replay.");
+    parser.addHelpOption();
+    parser.addPositionalArgument("trace", "Link trace file.");
+    parser.addOption({"realtime", "Keep the recorded timing."});
+    parser.addOption({"repeat", "Number of passes, for the decoding benchmark.", "count", "1"});
+    parser.addOption({"verbose", "Print decoded board frames and railtest records."});
+    parser.process(a);
+
+    if (parser.positionalArguments().isEmpty())
+        parser.showHelp(1);
+
+    LinkTraceReader trace;
+
+    if (!trace.open(parser.positionalArguments().first()))
+        return 1;
+
+    bool realTime = parser.isSet("realtime");
+    bool verbose = parser.isSet("verbose");
+    int repeat = realTime ? 1 : qMax(1, parser.value("repeat").toInt());
+
+    RailtestEngine engines[3];
+    QMap<int, int> boardFrames;
+    int railtestRecords = 0;
+
+    for (int i = 0; i < 3; ++i)
+    {
+        engines[i].setRecordHandler([&, i](const RailtestReply &record)
+        {
+            ++railtestRecords;
+            if (verbose)
+                qInfo().noquote() << QString("DUT%1").arg(i + 1) << record.text().trimmed();
+        });
+    }
+
+    SlipCodec codec([&](int channel, const char *data, int size)
+    {
+        if (channel >= 1 && channel <= 3)
+        {
+            engines[channel - 1].feed(data, size);
+
+            return;
+        }
+
+        if (channel != 0 || size < (int)sizeof(MB_Packet_t))
+            return;
+
+        const MB_Packet_t *header = (const MB_Packet_t*)data;
+        int type = qFromBigEndian(header->type);
+
+        ++boardFrames[type];
+        if (verbose)
+            qInfo().noquote() << QString("MB type 0x%1 seq %2 %3").arg(type, 4, 16, QChar('0')).arg(header->sequence)
+                                 .arg(QString(QByteArray(data + sizeof(MB_Packet_t), size - (int)sizeof(MB_Packet_t)).toHex()));
+    });
+
+    LinkTraceReader::Record record;
+    qint64 rxBytes = 0;
+    qint64 txBytes = 0;
+    qint64 duration = 0;
+    QElapsedTimer timer;
+
+    timer.start();
+    for (int pass = 0; pass < repeat; ++pass)
+    {
+        trace.rewind();
+        codec.reset();
+        for (auto & engine : engines)
+            engine.reset();
+
+        while (trace.next(&record))
+        {
+            duration = record.usecs;
+
+            if (LinkTrace::Tx == record.direction)
+            {
+                txBytes += record.size;
+                continue;
+            }
+
+            if (realTime)
+            {
+                qint64 rest = record.usecs - timer.nsecsElapsed() / 1000;
+
+                if (rest > 0)
+                    QThread::usleep((unsigned long)rest);
+            }
+
+            rxBytes += record.size;
+            codec.feed(record.data, record.size);
+        }
+    }
+
+    double secs = timer.nsecsElapsed() / 1e9;
+    const SlipCodec::Stats &stats = codec.stats();
+
+    qInfo().noquote() << QString("Trace started %1, %2 s, %3 bytes received, %4 bytes sent per pass")
+                         .arg(trace.startTime().toString(Qt::ISODate)).arg(duration / 1e6, 0, 'f', 3)
+                         .arg(rxBytes / repeat).arg(txBytes / repeat);
+    qInfo().noquote() << QString("Frames: %1, CRC errors: %2, escape errors: %3, short: %4, long: %5, railtest records: %6")
+                         .arg(stats.frames).arg(stats.crcErrors).arg(stats.escapeErrors).arg(stats.shortFrames).arg(stats.longFrames)
+                         .arg(railtestRecords);
+
+    for (auto it = boardFrames.constBegin(); it != boardFrames.constEnd(); ++it)
+        qInfo().noquote() << QString("  MB type 0x%1: %2").arg(it.key(), 4, 16, QChar('0')).arg(it.value());
+
+    if (!realTime)
+        qInfo().noquote() << QString("Decoding: %1 MB/s").arg(rxBytes / secs / 1e6, 0, 'f', 1);
+
+    return 0;
+}
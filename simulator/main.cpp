@@ -0,0 +1,39 @@
+#include "MeasBoardSimulator.h"
+#include "version.h"
+
+#include <QCoreApplication>
+#include <QCommandLineParser>
+#include <QDebug>
+
+// Measuring board simulator for running the test station without fixtures:
+//
+//   MeasBoardSimulator --config simulator.ini --link /tmp/measboard1
+//
+// Point the station to the printed PTY (or to the symlink) with the [SerialPorts] section of settings.ini.
+int main(int argc, char *argv[])
+{
+    QCoreApplication a(argc, argv);
+
+    a.setOrganizationName("Capelon AB");
+    a.setApplicationName("MeasBoardSimulator");
+    a.setApplicationVersion(CTS_VERSION);
+
+    QCommandLineParser parser;
+
+    parser.setApplicationDescription("Measuring board firmware simulator on a pseudo-terminal.");
+    parser.addHelpOption();
+    parser.addVersionOption();
+    parser.addOption({{"c", "config"}, "Simulated board settings (ADC values, latencies, DUTs).", "file", "simulator.ini"});
+    parser.addOption({{"l", "link"}, "Symlink to create for the PTY slave.", "path"});
+    parser.process(a);
+
+    QSharedPointer<QSettings> settings = QSharedPointer<QSettings>::create(parser.value("config"), QSettings::IniFormat);
+    MeasBoardSimulator simulator(settings);
+
+    if (!simulator.open(parser.value("link")))
+        return 1;
+
+    qInfo().noquote() << "Measuring board simulator is listening on" << simulator.portName();
+
+    return a.exec();
+}